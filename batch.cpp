@@ -0,0 +1,482 @@
+// Headless batch processing: load meshes, apply a chain of operations and
+// write the results. Uses only the geometry core (no OpenGL / window).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+#include "components.h"
+#include "decimate.h"
+#include "denoise.h"
+#include "mesh.h"
+#include "mesh_cache.h"
+#include "parallel.h"
+#include "repair.h"
+#include "smooth.h"
+#include "trace.h"
+#include "weld.h"
+
+enum class OperationKind {
+    RemoveBoundary,     // removeBoundaryFaces
+    Peel,               // peelBoundaryFaces
+    Floaters,           // removeSmallComponents
+    Weld,               // weldVertices
+    Denoise,            // denoiseMesh
+    Taubin,             // taubinSmooth
+    Decimate,           // decimateMesh
+    Repair              // repairNonManifold
+};
+
+struct Operation {
+    OperationKind kind;
+    int boundarySelection = 0;     // 0/1/2 = faces with 1/2/3 boundary edges
+    int maxIterations = 0;         // Peel: 0 = until stable
+    int minFaces = 0;              // Floaters
+    float minArea = 0.0f;          // Floaters
+    float epsilon = 0.0f;          // Weld
+    DenoiseSettings denoise;       // Denoise
+    TaubinSettings taubin;         // Taubin
+    DecimateSettings decimate;     // Decimate
+    RepairSettings repair;         // Repair
+};
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string outputDir;
+    std::vector<Operation> operations;
+    bool useCache = true;
+    bool verbose = false;
+    bool selfTest = false;
+};
+
+// Stream buffer that drops everything (and keeps no state, so threads may share it)
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Points std::cout at another buffer while alive. The buffer pointer is not
+// synchronized, so construct and destroy it only while no other thread runs.
+class CoutRedirect {
+public:
+    explicit CoutRedirect(std::streambuf* buffer) : saved_(std::cout.rdbuf(buffer)) {}
+    ~CoutRedirect() { std::cout.rdbuf(saved_); }
+
+    CoutRedirect(const CoutRedirect&) = delete;
+    CoutRedirect& operator=(const CoutRedirect&) = delete;
+
+    std::streambuf* saved() const { return saved_; }
+
+private:
+    std::streambuf* saved_;
+};
+
+struct FileResult {
+    bool ok = false;
+    size_t facesBefore = 0;
+    size_t facesAfter = 0;
+    double seconds = 0.0;
+};
+
+void printUsage()
+{
+    std::cerr <<
+        "usage: mesh_batch [options] -o <output dir> <file.obj | directory>...\n"
+        "\n"
+        "Applies the operations in order to every input mesh and writes <output dir>/<name>.obj.\n"
+        "Inputs must have distinct file names.\n"
+        "Directories are expanded to the .obj files they contain.\n"
+        "\n"
+        "options:\n"
+        "  -o, --output DIR          output directory (created if missing)\n"
+        "  --op OPERATION            append an operation (repeatable):\n"
+        "      remove-boundary:N     remove faces with N boundary edges (1-3)\n"
+        "      peel:N[:MAX]          remove faces with N boundary edges until stable (at most MAX rounds)\n"
+        "      floaters:MIN[:AREA]   remove components with fewer than MIN faces or less than AREA area\n"
+        "      weld:EPS              merge vertices closer than EPS\n"
+        "      denoise:N[:SIGMA[:V]] N bilateral normal passes with normal sigma SIGMA (default 0.35),\n"
+        "                            then V vertex passes (default 10)\n"
+        "      taubin:N[:L:M][:free] N Taubin iterations with steps L and M (default 0.5, -0.53);\n"
+        "                            boundary vertices stay in place unless :free is given\n"
+        "      decimate:F[:E][:free] collapse edges down to F faces (0 = no target) or quadric error E;\n"
+        "                            boundary vertices stay in place unless :free is given\n"
+        "      repair:split|drop     make non-manifold edges and vertices manifold by splitting vertices\n"
+        "                            per fan, or by first dropping all but the largest fan\n"
+        "  --no-cache                parse OBJ files without reading or writing .nmc caches\n"
+        "  -v, --verbose             print per-stage statistics (processes one file at a time)\n"
+        "  --self-test               check the operation parser and exit\n"
+        "\n"
+        "NMD_THREADS sets the number of worker threads.\n";
+}
+
+// Split "a:b:c" into fields
+std::vector<std::string> splitFields(const std::string& text)
+{
+    std::vector<std::string> fields;
+    std::stringstream ss(text);
+    std::string field;
+    while (std::getline(ss, field, ':')) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+// Strip a trailing "free" field (sets free) and check that the operation's
+// first argument is still there, so "taubin:free" is rejected
+bool takeFreeFlag(std::vector<std::string>& fields, bool& free)
+{
+    free = fields.back() == "free";
+    if (free) {
+        fields.pop_back();
+    }
+    return fields.size() >= 2;
+}
+
+bool parseOperation(const std::string& text, Operation& op)
+{
+    std::vector<std::string> fields = splitFields(text);
+    if (fields.size() < 2) {
+        return false;
+    }
+    char* end = nullptr;
+    if (fields[0] == "remove-boundary" || fields[0] == "peel") {
+        long edges = std::strtol(fields[1].c_str(), &end, 10);
+        if (*end != '\0' || edges < 1 || edges > 3) {
+            return false;
+        }
+        op.kind = fields[0] == "peel" ? OperationKind::Peel : OperationKind::RemoveBoundary;
+        op.boundarySelection = static_cast<int>(edges) - 1;
+        if (fields.size() > 2) {
+            if (op.kind != OperationKind::Peel) {
+                return false;
+            }
+            op.maxIterations = static_cast<int>(std::strtol(fields[2].c_str(), &end, 10));
+            if (*end != '\0' || op.maxIterations < 0) {
+                return false;
+            }
+        }
+        return fields.size() <= 3;
+    }
+    if (fields[0] == "floaters") {
+        op.kind = OperationKind::Floaters;
+        op.minFaces = static_cast<int>(std::strtol(fields[1].c_str(), &end, 10));
+        if (*end != '\0' || op.minFaces < 0) {
+            return false;
+        }
+        if (fields.size() > 2) {
+            op.minArea = std::strtof(fields[2].c_str(), &end);
+            if (*end != '\0') {
+                return false;
+            }
+        }
+        return fields.size() <= 3;
+    }
+    if (fields[0] == "weld") {
+        op.kind = OperationKind::Weld;
+        op.epsilon = std::strtof(fields[1].c_str(), &end);
+        return *end == '\0' && op.epsilon > 0.0f && fields.size() == 2;
+    }
+    if (fields[0] == "denoise") {
+        op.kind = OperationKind::Denoise;
+        op.denoise.normalIterations = static_cast<int>(std::strtol(fields[1].c_str(), &end, 10));
+        if (*end != '\0' || op.denoise.normalIterations < 0) {
+            return false;
+        }
+        if (fields.size() > 2) {
+            op.denoise.sigmaNormal = std::strtof(fields[2].c_str(), &end);
+            if (*end != '\0' || !(op.denoise.sigmaNormal > 0.0f)) {
+                return false;
+            }
+        }
+        if (fields.size() > 3) {
+            op.denoise.vertexIterations = static_cast<int>(std::strtol(fields[3].c_str(), &end, 10));
+            if (*end != '\0' || op.denoise.vertexIterations < 0) {
+                return false;
+            }
+        }
+        return fields.size() <= 4;
+    }
+    if (fields[0] == "taubin") {
+        op.kind = OperationKind::Taubin;
+        bool free = false;
+        if (!takeFreeFlag(fields, free)) {
+            return false;
+        }
+        op.taubin.pinBoundary = !free;
+        op.taubin.iterations = static_cast<int>(std::strtol(fields[1].c_str(), &end, 10));
+        if (*end != '\0' || op.taubin.iterations < 0) {
+            return false;
+        }
+        if (fields.size() == 4) {
+            op.taubin.lambda = std::strtof(fields[2].c_str(), &end);
+            if (*end != '\0' || !(op.taubin.lambda > 0.0f)) {
+                return false;
+            }
+            op.taubin.mu = std::strtof(fields[3].c_str(), &end);
+            if (*end != '\0' || !(op.taubin.mu < 0.0f)) {
+                return false;
+            }
+        }
+        return fields.size() == 2 || fields.size() == 4;
+    }
+    if (fields[0] == "decimate") {
+        op.kind = OperationKind::Decimate;
+        bool free = false;
+        if (!takeFreeFlag(fields, free)) {
+            return false;
+        }
+        op.decimate.preserveBoundary = !free;
+        op.decimate.targetFaces = static_cast<int>(std::strtol(fields[1].c_str(), &end, 10));
+        if (*end != '\0' || op.decimate.targetFaces < 0) {
+            return false;
+        }
+        if (fields.size() > 2) {
+            op.decimate.maxError = std::strtof(fields[2].c_str(), &end);
+            if (*end != '\0' || !(op.decimate.maxError > 0.0f)) {
+                return false;
+            }
+        }
+        return fields.size() <= 3 && (op.decimate.targetFaces > 0 || op.decimate.maxError > 0.0f);
+    }
+    if (fields[0] == "repair") {
+        op.kind = OperationKind::Repair;
+        op.repair.dropSmallFans = fields[1] == "drop";
+        return (fields[1] == "split" || fields[1] == "drop") && fields.size() == 2;
+    }
+    return false;
+}
+
+bool parseArguments(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--op" && i + 1 < argc) {
+            Operation op;
+            if (!parseOperation(argv[++i], op)) {
+                std::cerr << "Invalid operation: " << argv[i] << "\n";
+                return false;
+            }
+            options.operations.push_back(op);
+        } else if (arg == "--no-cache") {
+            options.useCache = false;
+        } else if (arg == "-v" || arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--self-test") {
+            options.selfTest = true;
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return options.selfTest || (!options.inputs.empty() && !options.outputDir.empty());
+}
+
+// Operation strings that must (or must not) parse; returns false on any mismatch
+bool runSelfTest()
+{
+    const struct {
+        const char* text;
+        bool valid;
+    } cases[] = {
+        {"decimate:1000", true},
+        {"decimate:1000:free", true},
+        {"decimate:0:0.01", true},
+        {"decimate:free", false},
+        {"decimate:0", false},
+        {"decimate", false},
+        {"taubin:10", true},
+        {"taubin:10:0.5:-0.53:free", true},
+        {"taubin:free", false},
+        {"taubin:10:0.5", false},
+        {"peel:1", true},
+        {"peel:2:5", true},
+        {"peel:1:x", false},
+        {"peel:1:-1", false},
+        {"remove-boundary:1:5", false},
+    };
+    int failures = 0;
+    for (const auto& c : cases) {
+        Operation op;
+        if (parseOperation(c.text, op) != c.valid) {
+            std::cerr << "self-test: \"" << c.text << "\" should " << (c.valid ? "" : "not ") << "parse\n";
+            failures++;
+        }
+    }
+    std::cerr << "self-test: " << (sizeof(cases) / sizeof(cases[0]) - failures) << "/"
+              << sizeof(cases) / sizeof(cases[0]) << " parse checks passed\n";
+    return failures == 0;
+}
+
+bool isDirectory(const std::string& path)
+{
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Expand directories to their .obj files (sorted, so output order is stable)
+std::vector<std::string> collectInputs(const std::vector<std::string>& inputs)
+{
+    std::vector<std::string> files;
+    for (const std::string& input : inputs) {
+        if (!isDirectory(input)) {
+            files.push_back(input);
+            continue;
+        }
+        std::string dirPath = input.back() == '/' ? input : input + "/";
+        std::vector<std::string> found;
+        DIR* dir = opendir(dirPath.c_str());
+        if (!dir) {
+            std::cerr << "Failed to open directory: " << input << "\n";
+            continue;
+        }
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string filename = entry->d_name;
+            if (filename.length() > 4 && filename.substr(filename.length() - 4) == ".obj") {
+                found.push_back(dirPath + filename);
+            }
+        }
+        closedir(dir);
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+std::string baseName(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void applyOperation(Mesh& mesh, const Operation& op)
+{
+    switch (op.kind) {
+    case OperationKind::RemoveBoundary:
+        removeBoundaryFaces(mesh, op.boundarySelection);
+        break;
+    case OperationKind::Peel:
+        peelBoundaryFaces(mesh, op.boundarySelection, op.maxIterations);
+        break;
+    case OperationKind::Floaters:
+        removeSmallComponents(mesh, op.minFaces, op.minArea);
+        break;
+    case OperationKind::Weld:
+        weldVertices(mesh, op.epsilon);
+        break;
+    case OperationKind::Denoise:
+        denoiseMesh(mesh, op.denoise);
+        break;
+    case OperationKind::Taubin:
+        taubinSmooth(mesh, op.taubin);
+        break;
+    case OperationKind::Decimate:
+        decimateMesh(mesh, op.decimate);
+        break;
+    case OperationKind::Repair:
+        repairNonManifold(mesh, op.repair);
+        break;
+    }
+}
+
+FileResult processFile(const std::string& path, const Options& options)
+{
+    FileResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    Mesh mesh = options.useCache ? loadMesh(path) : loadOBJ(path);
+    if (mesh.indices.empty()) {
+        return result;
+    }
+    result.facesBefore = mesh.indices.size() / 3;
+    for (const Operation& op : options.operations) {
+        applyOperation(mesh, op);
+    }
+    result.facesAfter = mesh.indices.size() / 3;
+    // Written files only keep referenced vertices, numbered by first use
+    removeUnusedVertices(mesh, true);
+    result.ok = saveOBJ(mesh, options.outputDir + "/" + baseName(path));
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+    if (options.selfTest) {
+        return runSelfTest() ? 0 : 1;
+    }
+
+    // Per-stage statistics from the geometry core go to std::cout. Verbose mode
+    // keeps them and runs one file at a time so logs stay readable; otherwise
+    // they are dropped and files are processed concurrently on the thread pool.
+    // The redirect is set up here, before any pool thread starts, and undone
+    // when main returns, after every job has finished.
+    NullBuffer discard;
+    CoutRedirect redirect(options.verbose ? std::cout.rdbuf() : &discard);
+    std::ostream summary(redirect.saved());
+    if (!isDirectory(options.outputDir) && ::mkdir(options.outputDir.c_str(), 0755) != 0) {
+        std::cerr << "Failed to create output directory: " << options.outputDir << "\n";
+        return 1;
+    }
+
+    std::vector<std::string> files = collectInputs(options.inputs);
+    if (files.empty()) {
+        std::cerr << "No input meshes\n";
+        return 1;
+    }
+    // Outputs are named after the input file only, so equal names would overwrite each other
+    std::vector<std::pair<std::string, std::string>> names;
+    for (const std::string& file : files) {
+        names.emplace_back(baseName(file), file);
+    }
+    std::sort(names.begin(), names.end());
+    for (size_t i = 1; i < names.size(); ++i) {
+        if (names[i].first == names[i - 1].first) {
+            std::cerr << "Inputs " << names[i - 1].second << " and " << names[i].second
+                      << " would both be written to " << options.outputDir << "/" << names[i].first << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::future<FileResult>> pending;
+    if (!options.verbose) {
+        for (const std::string& file : files) {
+            pending.push_back(defaultThreadPool().submit([&file, &options]() { return processFile(file, options); }));
+        }
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        FileResult result = options.verbose ? processFile(files[i], options) : pending[i].get();
+        if (!result.ok) {
+            failures++;
+            summary << files[i] << ": failed\n";
+            continue;
+        }
+        summary << files[i] << ": " << result.facesBefore << " -> " << result.facesAfter
+                << " faces (" << result.seconds * 1000.0 << " ms)\n";
+    }
+
+    TRACE_EXPORT("nmd_trace.json");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,394 @@
+// Benchmarks for the mesh pipeline stages. Prints one JSON object per
+// (mesh, stage) to stdout and a readable summary to stderr.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+#include "decimate.h"
+#include "denoise.h"
+#include "mesh.h"
+#include "normals.h"
+#include "parallel.h"
+#include "repair.h"
+#include "smooth.h"
+
+// Stream buffer that drops everything (silences the pipeline's statistics)
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+struct Options {
+    std::string objPath = "mesh/hotdog/shape1.obj";
+    std::vector<size_t> syntheticFaces = {10000, 100000, 1000000, 10000000, 50000000};
+    std::vector<std::string> stages;       // Empty = default set
+    int repetitions = 5;
+    std::string tmpDir = "/tmp";
+};
+
+// One benchmark input
+struct BenchMesh {
+    std::string name;
+    std::string objPath;      // OBJ on disk for the load stages
+    size_t objBytes = 0;
+    Mesh mesh;                // Fully loaded mesh
+};
+
+// A timed stage: setup is not timed, run is
+struct Stage {
+    std::string name;
+    std::string unit;                         // Throughput unit
+    double items = 0.0;                       // Items processed per run
+    std::function<void()> setup;
+    std::function<void()> run;
+    std::function<std::string()> check = {};  // Empty string if the result is valid
+};
+
+void printUsage()
+{
+    std::cerr <<
+        "usage: mesh_bench [options]\n"
+        "\n"
+        "  --obj PATH          real mesh to benchmark (default mesh/hotdog/shape1.obj, \"\" to skip)\n"
+        "  --sizes N,N,...     synthetic face counts (default 10000,100000,1000000,10000000,50000000)\n"
+        "  --stages S,S,...    stages to run (default: all; load_stream only up to 1M faces)\n"
+        "  --reps N            repetitions per stage, median is reported (default 5)\n"
+        "  --tmp DIR           where synthetic OBJ files are written (default /tmp)\n"
+        "\n"
+        "stages: load_stream load_mapped load_parallel computeFaceNormals buildEdgeFaceAdjacency\n"
+        "        buildHalfEdges analyzeMesh findBoundaryFaces removeBoundaryFaces denoiseMesh\n"
+        "        taubinSmooth decimateMesh (to 1/20 of the faces)\n"
+        "        decimateMesh_exhaust (until no collapse is left) repairNonManifold\n"
+        "\n"
+        "NMD_SIMD=avx512, avx2 (default) or scalar picks the face normal kernel.\n";
+}
+
+std::vector<std::string> splitList(const std::string& text)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool parseArguments(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--obj" && i + 1 < argc) {
+            options.objPath = argv[++i];
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            options.syntheticFaces.clear();
+            for (const std::string& size : splitList(argv[++i])) {
+                options.syntheticFaces.push_back(std::strtoull(size.c_str(), nullptr, 10));
+            }
+        } else if (arg == "--stages" && i + 1 < argc) {
+            options.stages = splitList(argv[++i]);
+        } else if (arg == "--reps" && i + 1 < argc) {
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--tmp" && i + 1 < argc) {
+            options.tmpDir = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reset the peak resident set size, where the OS allows it (Linux)
+void resetPeakMemory()
+{
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs.is_open()) {
+        clearRefs << "5";
+    }
+}
+
+// Peak resident set size in MB since the last reset (or since start)
+double peakMemoryMB()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::strtod(line.c_str() + 6, nullptr) / 1024.0;
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+// Noisy height field with ~1% of the quads missing, so there are boundaries
+// of every class. Vertices are unique; faces come out in row order.
+Mesh makeSyntheticMesh(size_t targetFaces, unsigned seed)
+{
+    Mesh mesh;
+    int side = std::max(2, static_cast<int>(std::sqrt(targetFaces / 2.0)) + 1);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    mesh.vertices.reserve(static_cast<size_t>(side) * side);
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x) {
+            float u = static_cast<float>(x) / (side - 1);
+            float v = static_cast<float>(y) / (side - 1);
+            mesh.vertices.emplace_back(u, v, 0.05f * std::sin(6.0f * u) * std::cos(5.0f * v) + noise(rng));
+        }
+    }
+    mesh.indices.reserve(targetFaces * 3);
+    for (int y = 0; y + 1 < side && mesh.indices.size() < targetFaces * 3; ++y) {
+        for (int x = 0; x + 1 < side && mesh.indices.size() < targetFaces * 3; ++x) {
+            if (unit(rng) < 0.01f) continue;
+            int v00 = y * side + x;
+            int v10 = v00 + 1;
+            int v01 = v00 + side;
+            int v11 = v01 + 1;
+            mesh.indices.insert(mesh.indices.end(), {v00, v10, v11, v00, v11, v01});
+        }
+    }
+    computeFaceNormals(mesh);
+    return mesh;
+}
+
+// Write the mesh as a triangle soup (3 vertices per face), like NeRF
+// exports, so loading also exercises vertex welding. Returns bytes written.
+size_t writeSoupOBJ(const Mesh& mesh, const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return 0;
+    }
+    for (int index : mesh.indices) {
+        const glm::vec3& v = mesh.vertices[index];
+        std::fprintf(file, "v %f %f %f\n", v.x, v.y, v.z);
+    }
+    for (size_t f = 0; f < mesh.indices.size() / 3; ++f) {
+        std::fprintf(file, "f %zu %zu %zu\n", f * 3 + 1, f * 3 + 2, f * 3 + 3);
+    }
+    long bytes = std::ftell(file);
+    std::fclose(file);
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
+
+size_t fileSize(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+std::string jsonEscape(const std::string& text)
+{
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+bool wantStage(const Options& options, const std::string& stage, size_t numFaces)
+{
+    if (!options.stages.empty()) {
+        return std::find(options.stages.begin(), options.stages.end(), stage) != options.stages.end();
+    }
+    // The getline parser takes minutes on the largest inputs
+    return stage != "load_stream" || numFaces <= 1000000;
+}
+
+// Returns false if the stage's result check failed
+bool runStage(const Options& options, const BenchMesh& input, const Stage& stage, std::ostream& out)
+{
+    std::vector<double> seconds;
+    double peakMB = 0.0;
+    for (int rep = 0; rep < options.repetitions; ++rep) {
+        if (stage.setup) stage.setup();
+        resetPeakMemory();
+        auto start = std::chrono::steady_clock::now();
+        stage.run();
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        peakMB = std::max(peakMB, peakMemoryMB());
+        std::string error = stage.check ? stage.check() : std::string();
+        if (!error.empty()) {
+            std::fprintf(stderr, "%-28s %-24s FAILED: %s\n", input.name.c_str(), stage.name.c_str(), error.c_str());
+            return false;
+        }
+    }
+    std::sort(seconds.begin(), seconds.end());
+    double median = seconds[seconds.size() / 2];
+    if (seconds.size() % 2 == 0) {
+        median = 0.5 * (median + seconds[seconds.size() / 2 - 1]);
+    }
+    double throughput = median > 0.0 ? stage.items / median : 0.0;
+
+    char line[512];
+    std::snprintf(line, sizeof(line),
+        "{\"mesh\":\"%s\",\"faces\":%zu,\"vertices\":%zu,\"stage\":\"%s\",\"reps\":%d,\"threads\":%u,"
+        "\"median_ms\":%.4f,\"min_ms\":%.4f,\"max_ms\":%.4f,\"throughput\":%.6g,\"throughput_unit\":\"%s\","
+        "\"peak_rss_mb\":%.1f}",
+        jsonEscape(input.name).c_str(), input.mesh.indices.size() / 3, input.mesh.vertices.size(),
+        stage.name.c_str(), options.repetitions, parallelism(),
+        median * 1000.0, seconds.front() * 1000.0, seconds.back() * 1000.0, throughput, stage.unit.c_str(), peakMB);
+    out << line << std::endl;
+
+    std::fprintf(stderr, "%-28s %-24s %12.3f ms  %12.4g %s  %8.1f MB\n",
+        input.name.c_str(), stage.name.c_str(), median * 1000.0, throughput, stage.unit.c_str(), peakMB);
+    return true;
+}
+
+// Returns false if any stage failed its result check
+bool benchmarkMesh(const Options& options, BenchMesh& input, std::ostream& out)
+{
+    const size_t numFaces = input.mesh.indices.size() / 3;
+    const double faces = static_cast<double>(numFaces);
+    const double megabytes = input.objBytes / (1024.0 * 1024.0);
+    Mesh scratch;
+    EdgeTable edgeTable;
+    HalfEdges halfEdges;
+
+    std::vector<Stage> stages;
+    const std::pair<const char*, OBJLoadMode> loadModes[] = {
+        {"load_stream", OBJLoadMode::Stream},
+        {"load_mapped", OBJLoadMode::Mapped},
+        {"load_parallel", OBJLoadMode::Parallel},
+    };
+    for (const auto& [name, mode] : loadModes) {
+        OBJLoadMode loadMode = mode;
+        stages.push_back({name, "MB/s", megabytes,
+            [&scratch]() { scratch = Mesh(); },
+            [&scratch, &input, loadMode]() { scratch = loadOBJ(input.objPath, loadMode); }});
+    }
+    stages.push_back({"computeFaceNormals", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { computeFaceNormals(scratch); }});
+    stages.push_back({"buildEdgeFaceAdjacency", "faces/s", faces, nullptr,
+        [&]() { edgeTable = buildEdgeFaceAdjacency(input.mesh); }});
+    stages.push_back({"buildHalfEdges", "faces/s", faces, nullptr,
+        [&]() { halfEdges = buildHalfEdges(input.mesh); }});
+    stages.push_back({"analyzeMesh", "edges/s", static_cast<double>(input.mesh.edgeToFaces.size()), nullptr,
+        [&]() { analyzeMesh(input.mesh.edgeToFaces); }});
+    stages.push_back({"findBoundaryFaces", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { findBoundaryFaces(scratch); }});
+    stages.push_back({"removeBoundaryFaces", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { removeBoundaryFaces(scratch, 0); }});
+    stages.push_back({"denoiseMesh", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { denoiseMesh(scratch); }});
+    stages.push_back({"taubinSmooth", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { taubinSmooth(scratch); }});
+    // Indices in range and no degenerate faces after a collapse run
+    auto checkScratch = [&]() -> std::string {
+        const size_t numVertices = scratch.vertices.size();
+        for (size_t f = 0; f + 2 < scratch.indices.size(); f += 3) {
+            const int a = scratch.indices[f], b = scratch.indices[f + 1], c = scratch.indices[f + 2];
+            if (std::min({a, b, c}) < 0 || static_cast<size_t>(std::max({a, b, c})) >= numVertices) {
+                return "face " + std::to_string(f / 3) + " has an index out of range";
+            }
+            if (a == b || b == c || c == a) {
+                return "face " + std::to_string(f / 3) + " is degenerate";
+            }
+        }
+        return std::string();
+    };
+    // Both runs have no error limit; the second one collapses until no
+    // vertex has a valid collapse left
+    DecimateSettings decimate;
+    decimate.targetFaces = static_cast<int>(numFaces / 20);
+    stages.push_back({"decimateMesh", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { decimateMesh(scratch, decimate); }});
+    stages.back().check = checkScratch;
+    DecimateSettings exhaust;
+    exhaust.targetFaces = 1;
+    stages.push_back({"decimateMesh_exhaust", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { decimateMesh(scratch, exhaust); }});
+    stages.back().check = checkScratch;
+    stages.push_back({"repairNonManifold", "faces/s", faces,
+        [&]() { scratch = input.mesh; },
+        [&]() { repairNonManifold(scratch); }});
+
+    bool ok = true;
+    for (const Stage& stage : stages) {
+        if (!wantStage(options, stage.name, numFaces)) continue;
+        if (input.objPath.empty() && stage.name.compare(0, 5, "load_") == 0) continue;
+        ok = runStage(options, input, stage, out) && ok;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    // Keep the pipeline's own statistics out of the results
+    std::ostream out(std::cout.rdbuf());
+    NullBuffer discard;
+    std::cout.rdbuf(&discard);
+
+    bool ok = true;
+    if (!options.objPath.empty()) {
+        BenchMesh input;
+        size_t slash = options.objPath.find_last_of('/');
+        input.name = slash == std::string::npos ? options.objPath : options.objPath.substr(slash + 1);
+        input.objPath = options.objPath;
+        input.objBytes = fileSize(options.objPath);
+        input.mesh = loadOBJ(options.objPath);
+        if (input.mesh.indices.empty()) {
+            std::cerr << "Failed to load " << options.objPath << std::endl;
+        } else {
+            ok = benchmarkMesh(options, input, out) && ok;
+        }
+    }
+
+    for (size_t targetFaces : options.syntheticFaces) {
+        BenchMesh input;
+        input.name = "synthetic_" + std::to_string(targetFaces);
+        input.mesh = makeSyntheticMesh(targetFaces, 1234u);
+        input.mesh.edgeToFaces = buildEdgeFaceAdjacency(input.mesh);
+        input.mesh.halfEdges = buildHalfEdges(input.mesh);
+        findBoundaryFaces(input.mesh);
+
+        input.objPath = options.tmpDir + "/nmd_bench_" + std::to_string(targetFaces) + "_" + std::to_string(getpid()) + ".obj";
+        input.objBytes = writeSoupOBJ(input.mesh, input.objPath);
+        if (input.objBytes == 0) {
+            std::cerr << "Failed to write " << input.objPath << ", skipping load stages" << std::endl;
+            input.objPath.clear();
+        }
+        ok = benchmarkMesh(options, input, out) && ok;
+        if (!input.objPath.empty()) {
+            std::remove(input.objPath.c_str());
+        }
+    }
+
+    std::cout.rdbuf(out.rdbuf());
+    return ok ? 0 : 1;
+}
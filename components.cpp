@@ -0,0 +1,173 @@
+#include "components.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+MeshComponents findConnectedComponents(const Mesh& mesh)
+{
+    TRACE_FUNCTION();
+    MeshComponents components;
+    const int numFaces = static_cast<int>(mesh.indices.size() / 3);
+    const EdgeTable& edges = mesh.edgeToFaces;
+    const size_t grain = 1 << 14;
+
+    std::vector<std::atomic<int>> parent(numFaces);
+    parallelFor(numFaces, grain, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            parent[f].store(static_cast<int>(f), std::memory_order_relaxed);
+        }
+    });
+
+    // Chain the faces of every edge together
+    parallelFor(edges.size(), grain, [&](size_t begin, size_t end) {
+        for (size_t e = begin; e < end; ++e) {
+            const int* faces = edges.facesBegin(static_cast<int>(e));
+            int count = edges.faceCount(static_cast<int>(e));
+            for (int k = 1; k < count; ++k) {
+                unionFindUnite(parent, faces[0], faces[k]);
+            }
+        }
+    });
+
+    // Every root is the smallest face of its component; number roots in face
+    // order (block-wise prefix sum)
+    std::vector<int> root(numFaces);
+    parallelFor(numFaces, grain, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            root[f] = unionFindRoot(parent, static_cast<int>(f));
+        }
+    });
+    const size_t numBlocks = (static_cast<size_t>(numFaces) + grain - 1) / grain;
+    std::vector<int> blockRoots(numBlocks + 1, 0);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            int roots = 0;
+            for (size_t f = b * grain; f < std::min<size_t>(numFaces, (b + 1) * grain); ++f) {
+                roots += (root[f] == static_cast<int>(f));
+            }
+            blockRoots[b + 1] = roots;
+        }
+    });
+    for (size_t b = 0; b < numBlocks; ++b) {
+        blockRoots[b + 1] += blockRoots[b];
+    }
+    const int numComponents = blockRoots[numBlocks];
+    std::vector<int> rootId(numFaces, -1);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            int next = blockRoots[b];
+            for (size_t f = b * grain; f < std::min<size_t>(numFaces, (b + 1) * grain); ++f) {
+                if (root[f] == static_cast<int>(f)) rootId[f] = next++;
+            }
+        }
+    });
+
+    // Roots come first in their component, so every id is set by now
+    components.faceComponent.resize(numFaces);
+    std::vector<uint64_t> keys(numFaces);
+    std::vector<int> order(numFaces);
+    parallelFor(numFaces, grain, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            components.faceComponent[f] = rootId[root[f]];
+            keys[f] = static_cast<uint64_t>(components.faceComponent[f]);
+            order[f] = static_cast<int>(f);
+        }
+    });
+
+    // Group faces by component (stable), then reduce the grouped faces in
+    // fixed blocks. A component inside one block is written by that block;
+    // the partials of components crossing block boundaries (the first and
+    // last run of a block) are merged in block order afterwards. The blocks
+    // do not depend on the thread count, so neither do the areas.
+    int componentBits = 1;
+    while (componentBits < 32 && (int64_t(1) << componentBits) < numComponents) componentBits++;
+    parallelRadixSort(keys, order, componentBits);
+
+    struct Partial {
+        int component = -1;
+        int faces = 0;
+        float area = 0.0f;
+        glm::vec3 lo = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 hi = glm::vec3(std::numeric_limits<float>::lowest());
+    };
+    components.faceCounts.assign(numComponents, 0);
+    components.areas.assign(numComponents, 0.0f);
+    components.boundsMin.assign(numComponents, glm::vec3(std::numeric_limits<float>::max()));
+    components.boundsMax.assign(numComponents, glm::vec3(std::numeric_limits<float>::lowest()));
+    auto store = [&](const Partial& p) {
+        components.faceCounts[p.component] = p.faces;
+        components.areas[p.component] = p.area;
+        components.boundsMin[p.component] = p.lo;
+        components.boundsMax[p.component] = p.hi;
+    };
+    std::vector<Partial> firstRun(numBlocks), lastRun(numBlocks);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            const size_t first = b * grain;
+            const size_t last = std::min<size_t>(numFaces, (b + 1) * grain);
+            Partial run;
+            for (size_t i = first; i <= last; ++i) {
+                if (i == last || static_cast<int>(keys[i]) != run.component) {
+                    if (run.component >= 0) {
+                        // Runs touching the block's ends may continue in a neighbor
+                        if (i == last) lastRun[b] = run;
+                        else if (i - run.faces == first) firstRun[b] = run;
+                        else store(run);
+                    }
+                    if (i == last) break;
+                    run = Partial();
+                    run.component = static_cast<int>(keys[i]);
+                }
+                const int f = order[i];
+                const glm::vec3& v0 = mesh.vertices[mesh.indices[f * 3 + 0]];
+                const glm::vec3& v1 = mesh.vertices[mesh.indices[f * 3 + 1]];
+                const glm::vec3& v2 = mesh.vertices[mesh.indices[f * 3 + 2]];
+                run.faces++;
+                run.area += 0.5f * glm::length(glm::cross(v1 - v0, v2 - v0));
+                run.lo = glm::min(run.lo, glm::min(v0, glm::min(v1, v2)));
+                run.hi = glm::max(run.hi, glm::max(v0, glm::max(v1, v2)));
+            }
+        }
+    });
+    for (size_t b = 0; b < numBlocks; ++b) {
+        for (const Partial* p : {&firstRun[b], &lastRun[b]}) {
+            if (p->component < 0) continue;
+            components.faceCounts[p->component] += p->faces;
+            components.areas[p->component] += p->area;
+            components.boundsMin[p->component] = glm::min(components.boundsMin[p->component], p->lo);
+            components.boundsMax[p->component] = glm::max(components.boundsMax[p->component], p->hi);
+        }
+    }
+
+    int largest = components.faceCounts.empty() ? 0 : *std::max_element(components.faceCounts.begin(), components.faceCounts.end());
+    std::cout << "Connected components: " << numComponents << " (largest " << largest << " faces)\n";
+    return components;
+}
+
+int removeSmallComponents(Mesh& mesh, int minFaces, float minArea)
+{
+    TRACE_FUNCTION();
+    MeshComponents components = findConnectedComponents(mesh);
+
+    std::vector<char> small(components.size(), 0);
+    int removedComponents = 0;
+    for (size_t c = 0; c < components.size(); ++c) {
+        if (components.faceCounts[c] < minFaces || components.areas[c] < minArea) {
+            small[c] = 1;
+            removedComponents++;
+        }
+    }
+
+    std::vector<int> facesToRemove;
+    for (size_t f = 0; f < components.faceComponent.size(); ++f) {
+        if (small[components.faceComponent[f]]) facesToRemove.push_back(static_cast<int>(f));
+    }
+    std::cout << "Removing " << removedComponents << " small components\n";
+    if (!facesToRemove.empty()) {
+        removeFaces(mesh, facesToRemove);
+    }
+    return static_cast<int>(facesToRemove.size());
+}
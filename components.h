@@ -0,0 +1,28 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "mesh.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Edge-connected components of a mesh.
+// Component ids are ordered by the smallest face index in each component.
+struct MeshComponents {
+    std::vector<int> faceComponent;   // Component id of each face
+    std::vector<int> faceCounts;      // Faces per component
+    std::vector<float> areas;         // Surface area per component
+    std::vector<glm::vec3> boundsMin; // Bounding box per component
+    std::vector<glm::vec3> boundsMax;
+
+    size_t size() const { return faceCounts.size(); }
+};
+
+// Label faces connected through shared edges (including non-manifold edges)
+// with a parallel lock-free union-find over mesh.edgeToFaces.
+MeshComponents findConnectedComponents(const Mesh& mesh);
+
+// Remove components with fewer than minFaces faces or less than minArea surface area.
+// Returns the number of faces removed.
+int removeSmallComponents(Mesh& mesh, int minFaces, float minArea = 0.0f);
+
+#endif
@@ -0,0 +1,575 @@
+#include "decimate.h"
+#include "normals.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+constexpr double kInfiniteCost = std::numeric_limits<double>::infinity();
+
+// Weight of the planes that hold free boundary edges in place
+constexpr double kBoundaryWeight = 10.0;
+
+// A collapse may not turn any face by more than ~78 degrees
+constexpr double kMinNormalCosine = 0.2;
+
+// Symmetric 4x4 error quadric, upper triangle row by row:
+// xx xy xz xd / yy yz yd / zz zd / dd
+struct Quadric {
+    double a[10] = {};
+
+    // Squared distance to the plane n.p + d = 0 (n unit length), times weight
+    static Quadric plane(const glm::dvec3& n, double d, double weight) {
+        Quadric q;
+        q.a[0] = weight * n.x * n.x; q.a[1] = weight * n.x * n.y; q.a[2] = weight * n.x * n.z; q.a[3] = weight * n.x * d;
+        q.a[4] = weight * n.y * n.y; q.a[5] = weight * n.y * n.z; q.a[6] = weight * n.y * d;
+        q.a[7] = weight * n.z * n.z; q.a[8] = weight * n.z * d;
+        q.a[9] = weight * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& q) {
+        for (int i = 0; i < 10; ++i) a[i] += q.a[i];
+        return *this;
+    }
+
+    double error(const glm::dvec3& p) const {
+        return a[0] * p.x * p.x + 2.0 * a[1] * p.x * p.y + 2.0 * a[2] * p.x * p.z + 2.0 * a[3] * p.x
+             + a[4] * p.y * p.y + 2.0 * a[5] * p.y * p.z + 2.0 * a[6] * p.y
+             + a[7] * p.z * p.z + 2.0 * a[8] * p.z + a[9];
+    }
+
+    // Position with the smallest error; false if the quadric is (nearly) singular
+    bool optimum(glm::dvec3& p) const {
+        const double c00 = a[4] * a[7] - a[5] * a[5];
+        const double c01 = a[2] * a[5] - a[1] * a[7];
+        const double c02 = a[1] * a[5] - a[2] * a[4];
+        const double det = a[0] * c00 + a[1] * c01 + a[2] * c02;
+        const double trace = a[0] + a[4] + a[7];
+        if (!(std::fabs(det) > 1e-9 * trace * trace * trace)) {
+            return false;
+        }
+        const double c11 = a[0] * a[7] - a[2] * a[2];
+        const double c12 = a[1] * a[2] - a[0] * a[5];
+        const double c22 = a[0] * a[4] - a[1] * a[1];
+        const double inv = -1.0 / det;
+        p = glm::dvec3((c00 * a[3] + c01 * a[6] + c02 * a[8]) * inv,
+                       (c01 * a[3] + c11 * a[6] + c12 * a[8]) * inv,
+                       (c02 * a[3] + c12 * a[6] + c22 * a[8]) * inv);
+        return true;
+    }
+};
+
+// Cheapest known collapse of a vertex into one of its neighbors
+struct Collapse {
+    double cost = kInfiniteCost;
+    int target = -1;
+    glm::dvec3 position;
+};
+
+// Working state of one decimation. Faces keep their slots; a collapse
+// rewrites the removed vertex's corners and splices its corner list onto the
+// surviving vertex, so per-vertex face lists never need rebuilding.
+class Decimator {
+public:
+    Decimator(Mesh& mesh, const DecimateSettings& settings, const ProgressCallback& progress)
+        : mesh_(mesh), settings_(settings), progress_(progress) {}
+
+    DecimateResult run();
+
+private:
+    enum VertexKind : uint8_t { Interior = 0, Boundary = 1, Locked = 2 };
+
+    void setup();
+    void computeQuadrics();
+    template <typename F> void forEachFace(int v, F&& visit) const;
+    void collectRing(int v, std::vector<int>& ring) const;
+    Collapse bestCollapse(int v, std::vector<int>& ring, std::vector<int>& scratch,
+                          std::vector<Collapse>& placements) const;
+    Collapse placement(int v, int u) const;
+    bool allowed(int v, const Collapse& c, const std::vector<int>& ringV, std::vector<int>& ringU) const;
+    bool flipsFace(int moved, int other, const glm::dvec3& position) const;
+    void pruneCorners(int v);
+    void collapse(int v, const Collapse& c);
+    void writeBack();
+
+    Mesh& mesh_;
+    const DecimateSettings& settings_;
+    const ProgressCallback& progress_;
+
+    std::vector<glm::dvec3> positions_;
+    std::vector<Quadric> quadrics_;
+    std::vector<uint8_t> kind_;
+    std::vector<char> removed_;
+    std::vector<char> faceAlive_;
+    std::vector<int> firstCorner_;     // Corner list per vertex (linked through nextCorner_)
+    std::vector<int> lastCorner_;
+    std::vector<int> nextCorner_;
+    size_t liveFaces_ = 0;
+};
+
+template <typename F>
+void Decimator::forEachFace(int v, F&& visit) const
+{
+    for (int c = firstCorner_[v]; c >= 0; c = nextCorner_[c]) {
+        if (faceAlive_[c / 3]) visit(c / 3, c);
+    }
+}
+
+// Unique neighbors of v over its live faces
+void Decimator::collectRing(int v, std::vector<int>& ring) const
+{
+    ring.clear();
+    forEachFace(v, [&](int, int c) {
+        ring.push_back(mesh_.indices[nextHalfEdge(c)]);
+        ring.push_back(mesh_.indices[prevHalfEdge(c)]);
+    });
+    std::sort(ring.begin(), ring.end());
+    ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+}
+
+void Decimator::setup()
+{
+    TRACE_FUNCTION();
+    const size_t numVertices = mesh_.vertices.size();
+    const size_t numFaces = mesh_.indices.size() / 3;
+    const HalfEdges& halfEdges = mesh_.halfEdges;
+
+    positions_.resize(numVertices);
+    kind_.assign(numVertices, Interior);
+    removed_.assign(numVertices, 0);
+    faceAlive_.assign(numFaces, 1);
+    liveFaces_ = numFaces;
+
+    // Corner lists start as the half-edge vertex corners (already in order)
+    firstCorner_.assign(numVertices, -1);
+    lastCorner_.assign(numVertices, -1);
+    nextCorner_.assign(numFaces * 3, -1);
+    parallelFor(numVertices, 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            positions_[v] = glm::dvec3(mesh_.vertices[v]);
+            const int* first = halfEdges.cornersBegin(static_cast<int>(v));
+            const int* last = halfEdges.cornersEnd(static_cast<int>(v));
+            for (const int* c = first; c != last; ++c) {
+                nextCorner_[*c] = c + 1 != last ? c[1] : -1;
+                if (halfEdges.twins[*c] == kNonManifoldHalfEdge || halfEdges.twins[prevHalfEdge(*c)] == kNonManifoldHalfEdge) {
+                    kind_[v] = Locked;
+                } else if (kind_[v] != Locked && (halfEdges.twins[*c] == kBoundaryHalfEdge ||
+                                                  halfEdges.twins[prevHalfEdge(*c)] == kBoundaryHalfEdge)) {
+                    kind_[v] = settings_.preserveBoundary ? Locked : Boundary;
+                }
+            }
+            if (first != last) {
+                firstCorner_[v] = *first;
+                lastCorner_[v] = last[-1];
+            }
+        }
+    });
+}
+
+// Sum of the planes of each vertex's faces, plus perpendicular planes along
+// free boundary edges. Every vertex sums its own faces, so no atomics are needed.
+void Decimator::computeQuadrics()
+{
+    TRACE_FUNCTION();
+    const size_t numFaces = mesh_.indices.size() / 3;
+    std::vector<Quadric> faceQuadrics(numFaces);
+    parallelFor(numFaces, 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            const glm::dvec3& p0 = positions_[mesh_.indices[f * 3 + 0]];
+            const glm::dvec3& p1 = positions_[mesh_.indices[f * 3 + 1]];
+            const glm::dvec3& p2 = positions_[mesh_.indices[f * 3 + 2]];
+            glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+            const double length = glm::length(n);
+            if (!(length > 0.0) || !std::isfinite(length)) continue;
+            n = n / length;
+            faceQuadrics[f] = Quadric::plane(n, -glm::dot(n, p0), 1.0);
+        }
+    });
+
+    quadrics_.assign(mesh_.vertices.size(), Quadric());
+    const HalfEdges& halfEdges = mesh_.halfEdges;
+    parallelFor(mesh_.vertices.size(), 1 << 12, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            Quadric& q = quadrics_[v];
+            for (const int* c = halfEdges.cornersBegin(static_cast<int>(v)); c != halfEdges.cornersEnd(static_cast<int>(v)); ++c) {
+                q += faceQuadrics[*c / 3];
+                if (kind_[v] != Boundary) continue;
+                // Boundary half-edges touching v: the one leaving it and the one arriving
+                for (int h : {*c, prevHalfEdge(*c)}) {
+                    if (halfEdges.twins[h] != kBoundaryHalfEdge) continue;
+                    const glm::dvec3& a = positions_[mesh_.indices[h]];
+                    const glm::dvec3& b = positions_[mesh_.indices[nextHalfEdge(h)]];
+                    const glm::dvec3& o = positions_[mesh_.indices[prevHalfEdge(h)]];
+                    glm::dvec3 n = glm::cross(b - a, glm::cross(b - a, o - a));
+                    const double length = glm::length(n);
+                    if (!(length > 0.0) || !std::isfinite(length)) continue;
+                    n = n / length;
+                    q += Quadric::plane(n, -glm::dot(n, a), kBoundaryWeight);
+                }
+            }
+        }
+    });
+}
+
+// True if moving `moved` to position turns one of its faces that does not
+// also contain `other` too far, or makes it degenerate
+bool Decimator::flipsFace(int moved, int other, const glm::dvec3& position) const
+{
+    bool flips = false;
+    forEachFace(moved, [&](int, int c) {
+        if (flips) return;
+        const int b = mesh_.indices[nextHalfEdge(c)];
+        const int d = mesh_.indices[prevHalfEdge(c)];
+        if (b == other || d == other) return;   // Removed by the collapse
+        const glm::dvec3& pb = positions_[b];
+        const glm::dvec3& pd = positions_[d];
+        const glm::dvec3 before = glm::cross(pb - positions_[moved], pd - positions_[moved]);
+        const glm::dvec3 after = glm::cross(pb - position, pd - position);
+        const double lengths = glm::length(before) * glm::length(after);
+        flips = !(lengths > 0.0) || glm::dot(before, after) < kMinNormalCosine * lengths;
+    });
+    return flips;
+}
+
+// Cost and position of collapsing v into neighbor u, ignoring whether the
+// collapse is allowed; the position stays on u if u is not interior
+Collapse Decimator::placement(int v, int u) const
+{
+    Quadric q = quadrics_[u];
+    q += quadrics_[v];
+    Collapse c;
+    c.target = u;
+    if (kind_[u] != Interior) {
+        c.position = positions_[u];
+    } else if (!q.optimum(c.position)) {
+        // Singular quadric (flat or straight neighborhood): best of the ends and midpoint
+        const glm::dvec3 candidates[3] = {positions_[u], positions_[v], (positions_[u] + positions_[v]) * 0.5};
+        c.position = candidates[0];
+        double best = q.error(c.position);
+        for (int i = 1; i < 3; ++i) {
+            double e = q.error(candidates[i]);
+            if (e < best) {
+                best = e;
+                c.position = candidates[i];
+            }
+        }
+    }
+    c.cost = std::max(0.0, q.error(c.position));
+    return c;
+}
+
+// True if v may collapse into c.target at c.position
+bool Decimator::allowed(int v, const Collapse& c, const std::vector<int>& ringV, std::vector<int>& ringU) const
+{
+    const int u = c.target;
+    // Faces on the edge and their opposite vertices
+    int edgeFaces = 0;
+    int opposite[2] = {-1, -1};
+    forEachFace(v, [&](int, int corner) {
+        const int b = mesh_.indices[nextHalfEdge(corner)];
+        const int d = mesh_.indices[prevHalfEdge(corner)];
+        if (b == u || d == u) {
+            if (edgeFaces < 2) opposite[edgeFaces] = b == u ? d : b;
+            edgeFaces++;
+        }
+    });
+    if (edgeFaces == 0 || edgeFaces > 2) {
+        return false;
+    }
+    // A boundary vertex may only slide along a boundary edge into another boundary vertex
+    if (kind_[v] == Boundary && (kind_[u] == Interior || edgeFaces != 1)) {
+        return false;
+    }
+    if (kind_[v] == Interior && kind_[u] != Interior && edgeFaces != 2) {
+        return false;
+    }
+
+    // Link condition: the only neighbors u and v share are the edge's opposite vertices
+    collectRing(u, ringU);
+    int shared = 0;
+    for (size_t i = 0, j = 0; i < ringV.size() && j < ringU.size();) {
+        if (ringV[i] < ringU[j]) {
+            i++;
+        } else if (ringU[j] < ringV[i]) {
+            j++;
+        } else {
+            if (ringV[i] != opposite[0] && ringV[i] != opposite[1]) {
+                return false;
+            }
+            shared++;
+            i++;
+            j++;
+        }
+    }
+    if (shared != edgeFaces) {
+        return false;
+    }
+    // Never collapse the last triangle of a piece or flatten a tetrahedron
+    if (ringV.size() < 3 || ringU.size() < 3 || (ringV.size() == 3 && ringU.size() == 3 && edgeFaces == 2)) {
+        return false;
+    }
+    return !flipsFace(v, u, c.position) && !flipsFace(u, v, c.position);
+}
+
+// The topology and flip checks are the expensive part, so every neighbor is
+// priced first and the checks run cheapest first until one passes
+Collapse Decimator::bestCollapse(int v, std::vector<int>& ring, std::vector<int>& scratch,
+                                 std::vector<Collapse>& placements) const
+{
+    if (removed_[v] || kind_[v] == Locked) {
+        return Collapse();
+    }
+    collectRing(v, ring);
+    placements.clear();
+    for (int u : ring) {
+        placements.push_back(placement(v, u));
+    }
+    std::sort(placements.begin(), placements.end(), [](const Collapse& a, const Collapse& b) {
+        return a.cost < b.cost || (a.cost == b.cost && a.target < b.target);
+    });
+    for (const Collapse& c : placements) {
+        if (allowed(v, c, ring, scratch)) {
+            return c;
+        }
+    }
+    return Collapse();
+}
+
+// Unlink the corners of dead faces from v's list
+void Decimator::pruneCorners(int v)
+{
+    int previous = -1;
+    for (int c = firstCorner_[v]; c >= 0; c = nextCorner_[c]) {
+        if (!faceAlive_[c / 3]) continue;
+        if (previous < 0) firstCorner_[v] = c; else nextCorner_[previous] = c;
+        previous = c;
+    }
+    if (previous < 0) {
+        firstCorner_[v] = -1;
+    } else {
+        nextCorner_[previous] = -1;
+    }
+    lastCorner_[v] = previous;
+}
+
+// Remove v, moving its neighbor c.target to c.position
+void Decimator::collapse(int v, const Collapse& c)
+{
+    const int u = c.target;
+    int opposite[2];
+    int numOpposite = 0;
+    forEachFace(v, [&](int f, int corner) {
+        const int b = mesh_.indices[nextHalfEdge(corner)];
+        const int d = mesh_.indices[prevHalfEdge(corner)];
+        if (b == u || d == u) {
+            faceAlive_[f] = 0;
+            liveFaces_--;
+            if (numOpposite < 2) opposite[numOpposite++] = b == u ? d : b;
+        } else {
+            mesh_.indices[corner] = u;
+        }
+    });
+    if (firstCorner_[v] >= 0) {
+        if (firstCorner_[u] < 0) {
+            firstCorner_[u] = firstCorner_[v];
+        } else {
+            nextCorner_[lastCorner_[u]] = firstCorner_[v];
+        }
+        lastCorner_[u] = lastCorner_[v];
+    }
+    firstCorner_[v] = lastCorner_[v] = -1;
+    // Keep lists short: the dead faces' corners also sit in u's and the opposite vertices' lists
+    pruneCorners(u);
+    for (int i = 0; i < numOpposite; ++i) {
+        pruneCorners(opposite[i]);
+    }
+    positions_[u] = c.position;
+    quadrics_[u] += quadrics_[v];
+    removed_[v] = 1;
+}
+
+// Collapses run in passes. Each pass re-prices the vertices whose
+// neighborhood changed (in parallel), sorts all candidates by cost and
+// collapses greedily in that order, skipping any collapse that touches a
+// vertex already changed in this pass. Costs of untouched vertices stay exact,
+// so the greedy order matches a global priority queue up to that locking,
+// while all the pricing runs in parallel and in memory order.
+DecimateResult Decimator::run()
+{
+    DecimateResult result;
+    setup();
+    computeQuadrics();
+
+    const size_t numVertices = mesh_.vertices.size();
+    const size_t target = settings_.targetFaces > 0 ? static_cast<size_t>(settings_.targetFaces) : 0;
+    const double maxError = settings_.maxError > 0.0f ? settings_.maxError : kInfiniteCost;
+    std::vector<Collapse> best(numVertices);
+    std::vector<char> dirty(numVertices);
+    for (size_t v = 0; v < numVertices; ++v) {
+        dirty[v] = kind_[v] != Locked;
+    }
+    std::vector<char> touched(numVertices, 0);
+    std::vector<int> changed, candidates, ring, scratch;
+    std::vector<uint64_t> keys;
+    const size_t startFaces = liveFaces_;
+    size_t startCandidates = 0;
+
+    while (liveFaces_ > target) {
+        TRACE_ZONE("decimatePass");
+        changed.clear();
+        for (size_t v = 0; v < numVertices; ++v) {
+            if (dirty[v]) changed.push_back(static_cast<int>(v));
+            dirty[v] = 0;
+        }
+        parallelFor(changed.size(), 1 << 10, [&](size_t begin, size_t end) {
+            std::vector<int> ring, scratch;
+            std::vector<Collapse> placements;
+            for (size_t i = begin; i < end; ++i) {
+                best[changed[i]] = bestCollapse(changed[i], ring, scratch, placements);
+            }
+        });
+
+        // Candidates by cost; float bits of a non-negative cost sort like the
+        // cost, and the stable sort breaks ties by vertex id. Vertices without
+        // a valid collapse have no target and an infinite cost.
+        keys.clear();
+        candidates.clear();
+        for (size_t v = 0; v < numVertices; ++v) {
+            if (best[v].target >= 0 && std::isfinite(best[v].cost) && best[v].cost <= maxError) {
+                float cost = static_cast<float>(best[v].cost);
+                uint32_t bits;
+                std::memcpy(&bits, &cost, sizeof(bits));
+                keys.push_back(bits);
+                candidates.push_back(static_cast<int>(v));
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+        parallelRadixSort(keys, candidates, 32);
+        if (startCandidates == 0) {
+            startCandidates = candidates.size();
+        }
+
+        // Aim for the remaining faces (two per collapse), accepting somewhat
+        // more error than the goal-th cheapest collapse since locking skips many
+        const size_t goal = target > 0 ? (liveFaces_ - target + 1) / 2 : candidates.size();
+        const double passLimit = goal < candidates.size() ? 1.5 * best[candidates[goal]].cost : kInfiniteCost;
+        int passCollapses = 0;
+        changed.clear();
+        for (int v : candidates) {
+            const Collapse chosen = best[v];
+            const int u = chosen.target;
+            if (liveFaces_ <= target || (chosen.cost > passLimit && passCollapses > 0)) {
+                break;
+            }
+            if (touched[v] || touched[u]) {
+                continue;
+            }
+            // Earlier collapses in this pass may have changed the neighborhood
+            collectRing(v, ring);
+            if (!allowed(v, chosen, ring, scratch)) {
+                dirty[v] = 1;
+                continue;
+            }
+            collapse(v, chosen);
+            best[v] = Collapse();
+            touched[v] = touched[u] = 1;
+            changed.push_back(v);
+            changed.push_back(u);
+            passCollapses++;
+            result.collapses++;
+            result.lastError = static_cast<float>(chosen.cost);
+
+            // The survivor and its neighbors (both rings from the check above)
+            // are re-priced next pass; locked vertices never get a collapse
+            for (int w : ring) {
+                dirty[w] = kind_[w] != Locked;
+            }
+            for (int w : scratch) {
+                dirty[w] = kind_[w] != Locked;
+            }
+            dirty[v] = 0;
+        }
+        for (int v : changed) {
+            touched[v] = 0;
+        }
+        if (passCollapses == 0) {
+            break;
+        }
+        // Progress towards the face target, or without one, through the
+        // collapses that were below the error limit at the start
+        const float done = target > 0 ? static_cast<float>(startFaces - liveFaces_) / (startFaces - target)
+                                      : 1.0f - static_cast<float>(candidates.size()) / startCandidates;
+        if (!reportProgress(progress_, done)) {
+            break;
+        }
+    }
+    writeBack();
+    return result;
+}
+
+// Compact live faces and surviving vertices (both in their original order).
+// Surviving faces keep their faceOrigin entries.
+void Decimator::writeBack()
+{
+    TRACE_FUNCTION();
+    const size_t numVertices = mesh_.vertices.size();
+    const size_t numFaces = mesh_.indices.size() / 3;
+    std::vector<int> newIndex(numVertices, -1);
+    std::vector<glm::vec3> vertices;
+    for (size_t v = 0; v < numVertices; ++v) {
+        if (removed_[v]) continue;
+        newIndex[v] = static_cast<int>(vertices.size());
+        vertices.push_back(glm::vec3(static_cast<float>(positions_[v].x), static_cast<float>(positions_[v].y),
+                                     static_cast<float>(positions_[v].z)));
+    }
+    std::vector<int> indices;
+    indices.reserve(liveFaces_ * 3);
+    const bool trackOrigin = mesh_.faceOrigin.size() == numFaces;
+    std::vector<int> faceOrigin;
+    faceOrigin.reserve(trackOrigin ? liveFaces_ : 0);
+    for (size_t f = 0; f < numFaces; ++f) {
+        if (!faceAlive_[f]) continue;
+        for (int i = 0; i < 3; ++i) {
+            indices.push_back(newIndex[mesh_.indices[f * 3 + i]]);
+        }
+        if (trackOrigin) faceOrigin.push_back(mesh_.faceOrigin[f]);
+    }
+    mesh_.vertices = std::move(vertices);
+    mesh_.indices = std::move(indices);
+    if (trackOrigin) mesh_.faceOrigin = std::move(faceOrigin);
+}
+
+} // namespace
+
+DecimateResult decimateMesh(Mesh& mesh, const DecimateSettings& settings, const ProgressCallback& progress)
+{
+    TRACE_FUNCTION();
+    const size_t facesBefore = mesh.indices.size() / 3;
+    if (facesBefore == 0 || (settings.targetFaces <= 0 && !(settings.maxError > 0.0f))) {
+        return DecimateResult();
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    DecimateResult result = Decimator(mesh, settings, progress).run();
+
+    computeFaceNormals(mesh);
+    mesh.edgeToFaces = buildEdgeFaceAdjacency(mesh);
+    mesh.halfEdges = buildHalfEdges(mesh);
+    analyzeMesh(mesh.edgeToFaces);
+    findBoundaryFaces(mesh);
+    TRACE_COUNT(trace::Counter::FacesProcessed, facesBefore);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Decimated " << facesBefore << " -> " << mesh.indices.size() / 3 << " faces ("
+              << result.collapses << " collapses, last error " << result.lastError << ") in " << ms << " ms\n";
+    return result;
+}
@@ -0,0 +1,32 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include "mesh.h"
+
+struct DecimateSettings {
+    int targetFaces = 0;            // Stop at this many faces (0 = no face target)
+    float maxError = 0.0f;          // Stop before a collapse with a larger quadric error
+                                    // (sum of squared plane distances; 0 = no limit)
+    bool preserveBoundary = true;   // Boundary vertices never move or disappear
+};
+
+struct DecimateResult {
+    int collapses = 0;              // Vertices removed
+    float lastError = 0.0f;         // Quadric error of the last collapse
+};
+
+// Quadric error metric (Garland-Heckbert) edge-collapse simplification.
+// Works in passes: every vertex whose neighborhood changed is re-priced with
+// its cheapest valid collapse into a neighbor (in parallel), then the
+// candidates are radix-sorted by cost and an independent set of them is
+// collapsed cheapest first. A collapse is rejected if it would make the mesh
+// non-manifold (link condition) or flip a face. Non-manifold vertices are
+// never moved; without preserveBoundary, boundary vertices only collapse along
+// the boundary and their quadrics keep the outline in place. The result is
+// the same for any thread count. Rebuilds the adjacency and boundary
+// classification afterwards. progress is called after every pass; if it
+// cancels, the collapses done so far are kept.
+DecimateResult decimateMesh(Mesh& mesh, const DecimateSettings& settings,
+                            const ProgressCallback& progress = ProgressCallback());
+
+#endif
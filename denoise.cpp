@@ -0,0 +1,207 @@
+#include "denoise.h"
+#include "normals.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// Faces sharing at least one vertex with each face (itself excluded), as CSR
+struct FaceRing {
+    std::vector<size_t> offsets;
+    std::vector<int> faces;
+};
+
+// Unique faces around the corners of face f, appended to out
+void collectRing(const Mesh& mesh, int f, std::vector<int>& out)
+{
+    out.clear();
+    for (int i = 0; i < 3; ++i) {
+        const int v = mesh.indices[f * 3 + i];
+        for (const int* c = mesh.halfEdges.cornersBegin(v); c != mesh.halfEdges.cornersEnd(v); ++c) {
+            const int neighbor = *c / 3;
+            if (neighbor != f) out.push_back(neighbor);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+FaceRing buildFaceRing(const Mesh& mesh)
+{
+    TRACE_FUNCTION();
+    const size_t numFaces = mesh.indices.size() / 3;
+    FaceRing ring;
+    ring.offsets.assign(numFaces + 1, 0);
+    parallelFor(numFaces, 1 << 12, [&](size_t begin, size_t end) {
+        std::vector<int> local;
+        for (size_t f = begin; f < end; ++f) {
+            collectRing(mesh, static_cast<int>(f), local);
+            ring.offsets[f + 1] = local.size();
+        }
+    });
+    for (size_t f = 0; f < numFaces; ++f) {
+        ring.offsets[f + 1] += ring.offsets[f];
+    }
+    ring.faces.resize(ring.offsets[numFaces]);
+    parallelFor(numFaces, 1 << 12, [&](size_t begin, size_t end) {
+        std::vector<int> local;
+        for (size_t f = begin; f < end; ++f) {
+            collectRing(mesh, static_cast<int>(f), local);
+            std::copy(local.begin(), local.end(), ring.faces.begin() + ring.offsets[f]);
+        }
+    });
+    return ring;
+}
+
+// Centroid and area of every face for the given positions
+void faceCentroidsAndAreas(const Mesh& mesh, const std::vector<glm::vec3>& positions,
+                           std::vector<glm::vec3>& centroids, std::vector<float>& areas)
+{
+    const size_t numFaces = mesh.indices.size() / 3;
+    centroids.resize(numFaces);
+    areas.resize(numFaces);
+    parallelFor(numFaces, 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            const glm::vec3& v0 = positions[mesh.indices[f * 3 + 0]];
+            const glm::vec3& v1 = positions[mesh.indices[f * 3 + 1]];
+            const glm::vec3& v2 = positions[mesh.indices[f * 3 + 2]];
+            centroids[f] = (v0 + v1 + v2) / 3.0f;
+            float area = 0.5f * glm::length(glm::cross(v1 - v0, v2 - v0));
+            areas[f] = std::isfinite(area) ? area : 0.0f;
+        }
+    });
+}
+
+// Mean distance between the centroids of faces sharing a manifold edge
+float meanNeighborDistance(const Mesh& mesh, const std::vector<glm::vec3>& centroids)
+{
+    const size_t numHalfEdges = mesh.halfEdges.twins.size();
+    const size_t numBlocks = (numHalfEdges + (1 << 14) - 1) >> 14;
+    std::vector<double> blockSum(numBlocks, 0.0);
+    std::vector<size_t> blockCount(numBlocks, 0);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            for (size_t h = b << 14; h < std::min(numHalfEdges, (b + 1) << 14); ++h) {
+                const int twin = mesh.halfEdges.twins[h];
+                if (twin <= static_cast<int>(h)) continue;   // Each pair once
+                blockSum[b] += glm::length(centroids[h / 3] - centroids[twin / 3]);
+                blockCount[b]++;
+            }
+        }
+    });
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t b = 0; b < numBlocks; ++b) {
+        sum += blockSum[b];
+        count += blockCount[b];
+    }
+    return count > 0 ? static_cast<float>(sum / count) : 0.0f;
+}
+
+} // namespace
+
+void denoiseMesh(Mesh& mesh, const DenoiseSettings& settings, const ProgressCallback& progress)
+{
+    TRACE_FUNCTION();
+    const size_t numFaces = mesh.indices.size() / 3;
+    const size_t numVertices = mesh.vertices.size();
+    if (numFaces == 0 || mesh.faceNormals.size() != numFaces) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    const FaceRing ring = buildFaceRing(mesh);
+    std::vector<glm::vec3> centroids;
+    std::vector<float> areas;
+    faceCentroidsAndAreas(mesh, mesh.vertices, centroids, areas);
+
+    float sigmaSpatial = settings.sigmaSpatial > 0.0f ? settings.sigmaSpatial : meanNeighborDistance(mesh, centroids);
+    if (!(sigmaSpatial > 0.0f)) {
+        sigmaSpatial = 1.0f;
+    }
+    const float sigmaNormal = settings.sigmaNormal > 0.0f ? settings.sigmaNormal : 0.35f;
+    const float spatialScale = 1.0f / (2.0f * sigmaSpatial * sigmaSpatial);
+    const float normalScale = 1.0f / (2.0f * sigmaNormal * sigmaNormal);
+
+    // Positions stay fixed while the normals are filtered, so the area and
+    // spatial part of every neighbor's weight is computed once
+    std::vector<float> spatialWeights(ring.faces.size());
+    parallelFor(numFaces, 1 << 12, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            for (size_t k = ring.offsets[f]; k < ring.offsets[f + 1]; ++k) {
+                const int g = ring.faces[k];
+                const glm::vec3 dc = centroids[g] - centroids[f];
+                spatialWeights[k] = areas[g] * std::exp(-glm::dot(dc, dc) * spatialScale);
+            }
+        }
+    });
+
+    const int numPasses = settings.normalIterations + settings.vertexIterations;
+    int passesDone = 0;
+
+    // Bilateral filtering of the face normals
+    std::vector<glm::vec3> normals = mesh.faceNormals;
+    std::vector<glm::vec3> filtered(numFaces);
+    for (int iteration = 0; iteration < settings.normalIterations; ++iteration) {
+        TRACE_ZONE("filterNormals");
+        parallelFor(numFaces, 1 << 12, [&](size_t begin, size_t end) {
+            for (size_t f = begin; f < end; ++f) {
+                const glm::vec3& n = normals[f];
+                glm::vec3 sum = areas[f] * n;
+                for (size_t k = ring.offsets[f]; k < ring.offsets[f + 1]; ++k) {
+                    const int g = ring.faces[k];
+                    const glm::vec3 dn = normals[g] - n;
+                    sum += spatialWeights[k] * std::exp(-glm::dot(dn, dn) * normalScale) * normals[g];
+                }
+                const float length = glm::length(sum);
+                filtered[f] = length > 0.0f && std::isfinite(length) ? sum / length : n;
+            }
+        });
+        normals.swap(filtered);
+        if (!reportProgress(progress, static_cast<float>(++passesDone) / numPasses)) {
+            return;
+        }
+    }
+
+    // Move every vertex towards the planes through its faces' centroids with
+    // the filtered normals (positions double buffered as well)
+    std::vector<glm::vec3> positions = mesh.vertices;
+    std::vector<glm::vec3> updated(numVertices);
+    for (int iteration = 0; iteration < settings.vertexIterations; ++iteration) {
+        TRACE_ZONE("updateVertices");
+        if (iteration > 0) {
+            faceCentroidsAndAreas(mesh, positions, centroids, areas);
+        }
+        parallelFor(numVertices, 1 << 14, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v) {
+                const glm::vec3& p = positions[v];
+                const int* first = mesh.halfEdges.cornersBegin(static_cast<int>(v));
+                const int* last = mesh.halfEdges.cornersEnd(static_cast<int>(v));
+                glm::vec3 offset(0.0f);
+                for (const int* c = first; c != last; ++c) {
+                    const int f = *c / 3;
+                    offset += normals[f] * glm::dot(normals[f], centroids[f] - p);
+                }
+                updated[v] = last > first ? p + offset / static_cast<float>(last - first) : p;
+            }
+        });
+        positions.swap(updated);
+        if (!reportProgress(progress, static_cast<float>(++passesDone) / numPasses)) {
+            return;
+        }
+    }
+    spatialWeights = std::vector<float>();
+
+    mesh.vertices = std::move(positions);
+    computeFaceNormals(mesh);
+    TRACE_COUNT(trace::Counter::FacesProcessed, numFaces);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Denoised " << numFaces << " faces: " << settings.normalIterations << " normal passes (sigma_s "
+              << sigmaSpatial << ", sigma_n " << sigmaNormal << "), " << settings.vertexIterations
+              << " vertex passes in " << ms << " ms\n";
+}
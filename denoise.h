@@ -0,0 +1,25 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "mesh.h"
+
+struct DenoiseSettings {
+    int normalIterations = 20;    // Bilateral passes over the face normals
+    int vertexIterations = 10;    // Passes moving vertices onto the filtered normals
+    float sigmaNormal = 0.35f;    // Range weight: how different a neighbor's normal may be
+    float sigmaSpatial = 0.0f;    // Spatial weight on centroid distance (0 = mean distance
+                                  // between centroids of edge-adjacent faces)
+};
+
+// Bilateral face normal filtering followed by vertex position updates.
+// Every face normal is replaced by the area-weighted average of the normals
+// of the faces sharing a vertex with it, weighted down by centroid distance
+// and by normal difference. Normals are double buffered, so each pass is a
+// parallel loop over faces. Vertices are then moved to fit the filtered
+// normals. Topology is unchanged; mesh.faceNormals is recomputed at the end.
+// The result is the same for any thread count. progress is called after
+// every pass; if it cancels, the mesh is left unchanged.
+void denoiseMesh(Mesh& mesh, const DenoiseSettings& settings = DenoiseSettings(),
+                 const ProgressCallback& progress = ProgressCallback());
+
+#endif
@@ -0,0 +1,204 @@
+#include "history.h"
+#include "parallel.h"
+#include "trace.h"
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+// Tag every face with its own index so later removals can be traced back
+void tagFaceOrigins(Mesh& mesh)
+{
+    mesh.faceOrigin.resize(mesh.indices.size() / 3);
+    for (size_t f = 0; f < mesh.faceOrigin.size(); ++f) {
+        mesh.faceOrigin[f] = static_cast<int>(f);
+    }
+}
+
+// Record that edited vertex `from` is base vertex `to` (or the reverse);
+// false if it was already paired with a different vertex
+bool pairVertex(std::vector<std::atomic<int>>& pairs, int from, int to)
+{
+    int expected = -1;
+    return pairs[from].compare_exchange_strong(expected, to, std::memory_order_relaxed) || expected == to;
+}
+
+// True if edited is base minus some faces: origins are tracked and increasing,
+// every surviving face still has its base corner positions, and its corners
+// are the base corners under a one-to-one renumbering of the vertices (so
+// splitting or merging vertices is not a removal, even in place)
+bool isRemovalOf(const Mesh& base, const Mesh& edited)
+{
+    const size_t numFaces = edited.indices.size() / 3;
+    if (edited.faceOrigin.size() != numFaces) {
+        return false;
+    }
+    const size_t baseFaces = base.indices.size() / 3;
+    std::vector<std::atomic<int>> baseVertex(edited.vertices.size());
+    std::vector<std::atomic<int>> editedVertex(base.vertices.size());
+    parallelFor(baseVertex.size(), 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) baseVertex[v].store(-1, std::memory_order_relaxed);
+    });
+    parallelFor(editedVertex.size(), 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) editedVertex[v].store(-1, std::memory_order_relaxed);
+    });
+    std::atomic<bool> same(true);
+    parallelFor(numFaces, 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end && same.load(std::memory_order_relaxed); ++f) {
+            size_t origin = static_cast<size_t>(edited.faceOrigin[f]);
+            bool ok = origin < baseFaces && (f == 0 || edited.faceOrigin[f - 1] < edited.faceOrigin[f]);
+            for (int i = 0; ok && i < 3; ++i) {
+                const int v = edited.indices[f * 3 + i];
+                const int b = base.indices[origin * 3 + i];
+                ok = std::memcmp(&edited.vertices[v], &base.vertices[b], sizeof(glm::vec3)) == 0 &&
+                     pairVertex(baseVertex, v, b) && pairVertex(editedVertex, b, v);
+            }
+            if (!ok) same.store(false, std::memory_order_relaxed);
+        }
+    });
+    return same.load();
+}
+
+} // namespace
+
+MeshHistory::MeshHistory(Mesh base)
+{
+    tagFaceOrigins(base);
+    Base first;
+    first.removedAt.assign(base.indices.size() / 3, kNeverRemoved);
+    first.mesh = std::make_shared<const Mesh>(std::move(base));
+    current_ = first.mesh;
+    bases_.push_back(std::move(first));
+    stepBase_.push_back(0);
+}
+
+void MeshHistory::apply(const std::function<void(Mesh&)>& edit)
+{
+    Mesh edited = checkout();
+    edit(edited);
+    commit(std::move(edited));
+}
+
+Mesh MeshHistory::checkout()
+{
+    // Bases must stay; a removal step's mesh can be rebuilt from its base.
+    // Those are created non-const in commit and rebuildCurrent, so moving
+    // out of them is fine.
+    const bool rebuildable = current_ != bases_[stepBase_[cursor_]].mesh;
+    if (!rebuildable || current_.use_count() != 1) {
+        return *current_;
+    }
+    checkedOut_ = true;
+    return std::move(*std::const_pointer_cast<Mesh>(current_));
+}
+
+void MeshHistory::restore()
+{
+    if (checkedOut_) {
+        rebuildCurrent();
+        checkedOut_ = false;
+    }
+}
+
+void MeshHistory::commit(Mesh edited)
+{
+    TRACE_FUNCTION();
+    truncateRedo();
+    const int step = cursor_ + 1;
+    const int baseIndex = stepBase_[cursor_];
+    Base& base = bases_[baseIndex];
+
+    const bool wasCheckedOut = checkedOut_;
+    checkedOut_ = false;
+    if (isRemovalOf(*base.mesh, edited)) {
+        // Faces of the current mesh (those not removed up to the cursor) that
+        // did not survive were removed by this step
+        std::vector<char> survives(base.removedAt.size(), 0);
+        for (int origin : edited.faceOrigin) survives[origin] = 1;
+        std::vector<int> removedNow;
+        for (size_t f = 0; f < base.removedAt.size(); ++f) {
+            if (base.removedAt[f] > cursor_ && !survives[f]) removedNow.push_back(static_cast<int>(f));
+        }
+        if (removedNow.empty()) {
+            // Nothing changed; not worth a step
+            if (wasCheckedOut) current_ = std::make_shared<Mesh>(std::move(edited));
+            return;
+        }
+        for (int f : removedNow) base.removedAt[f] = step;
+        stepBase_.push_back(baseIndex);
+        current_ = std::make_shared<Mesh>(std::move(edited));
+    } else {
+        // Geometry changed: the result becomes a new base
+        tagFaceOrigins(edited);
+        Base next;
+        next.removedAt.assign(edited.indices.size() / 3, kNeverRemoved);
+        next.mesh = std::make_shared<const Mesh>(std::move(edited));
+        current_ = next.mesh;
+        bases_.push_back(std::move(next));
+        stepBase_.push_back(static_cast<int>(bases_.size()) - 1);
+    }
+    cursor_ = step;
+    revision_++;
+}
+
+bool MeshHistory::undo()
+{
+    if (!canUndo()) {
+        return false;
+    }
+    cursor_--;
+    rebuildCurrent();
+    revision_++;
+    return true;
+}
+
+bool MeshHistory::redo()
+{
+    if (!canRedo()) {
+        return false;
+    }
+    cursor_++;
+    rebuildCurrent();
+    revision_++;
+    return true;
+}
+
+void MeshHistory::reset()
+{
+    cursor_ = 0;
+    current_ = bases_[0].mesh;
+    revision_++;
+}
+
+// Drop the steps after the cursor: bases they created and their removals
+void MeshHistory::truncateRedo()
+{
+    if (cursor_ == numSteps()) {
+        return;
+    }
+    const int baseIndex = stepBase_[cursor_];
+    stepBase_.resize(cursor_ + 1);
+    bases_.resize(baseIndex + 1);
+    for (int& removed : bases_[baseIndex].removedAt) {
+        if (removed > cursor_) removed = kNeverRemoved;
+    }
+}
+
+// Current mesh = its base minus the faces removed at or before the cursor
+void MeshHistory::rebuildCurrent()
+{
+    TRACE_FUNCTION();
+    const Base& base = bases_[stepBase_[cursor_]];
+    std::vector<int> removed;
+    for (size_t f = 0; f < base.removedAt.size(); ++f) {
+        if (base.removedAt[f] <= cursor_) removed.push_back(static_cast<int>(f));
+    }
+    if (removed.empty()) {
+        current_ = base.mesh;
+        return;
+    }
+    Mesh mesh = *base.mesh;
+    removeFaces(mesh, removed);
+    removeUnusedVertices(mesh);
+    current_ = std::make_shared<Mesh>(std::move(mesh));
+}
@@ -0,0 +1,75 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "mesh.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Undo/redo history of one mesh without full copies per step.
+//
+// The loaded mesh is an immutable base shared by reference. A step that only
+// removes faces is stored as the step number in removedAt[face] of the base
+// (4 bytes per base face for the whole history); any other edit (welding,
+// smoothing) becomes a new base. The current mesh is shared with its base
+// until the first edit, reset is O(1), and undo/redo rebuild the current mesh
+// from its base.
+class MeshHistory {
+public:
+    explicit MeshHistory(Mesh base);
+
+    const Mesh& current() const { return *current_; }
+    std::shared_ptr<const Mesh> currentShared() const { return current_; }
+
+    // Run edit on the current mesh (see checkout) and record the result as the
+    // next step. Steps after the current one (the redo list) are discarded.
+    void apply(const std::function<void(Mesh&)>& edit);
+
+    // The current mesh, to be edited and passed to commit (or given up with
+    // restore). A mesh the history can rebuild from its base that nobody else
+    // shares is moved out rather than copied; current() is empty until then.
+    Mesh checkout();
+
+    // Rebuild the current mesh after a checkout whose edit was abandoned
+    void restore();
+
+    // Record an already edited mesh as the next step. edited must descend from
+    // current(); it is a pure removal if its faceOrigin traces every face back
+    // to a base face with the same corner positions and connectivity.
+    void commit(Mesh edited);
+
+    bool canUndo() const { return cursor_ > 0; }
+    bool canRedo() const { return cursor_ < numSteps(); }
+    bool undo();
+    bool redo();
+
+    // Back to the loaded mesh; redo can replay the steps
+    void reset();
+
+    int step() const { return cursor_; }
+
+    // Changes whenever current() gets different contents (to re-upload only edited meshes)
+    uint64_t revision() const { return revision_; }
+    int numSteps() const { return static_cast<int>(stepBase_.size()) - 1; }
+
+private:
+    static constexpr int kNeverRemoved = 0x7FFFFFFF;
+
+    struct Base {
+        std::shared_ptr<const Mesh> mesh;   // faceOrigin = 0 .. faces - 1
+        std::vector<int> removedAt;         // Step that removed each face
+    };
+
+    void truncateRedo();
+    void rebuildCurrent();
+
+    std::vector<Base> bases_;
+    std::vector<int> stepBase_;             // Base each step's result is built from (step 0 = load)
+    std::shared_ptr<const Mesh> current_;   // Removal steps own a non-const Mesh (see checkout)
+    int cursor_ = 0;
+    bool checkedOut_ = false;               // current_ was moved out by checkout
+    uint64_t revision_ = 0;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "jobs.h"
+#include <chrono>
+
+BackgroundJob::BackgroundJob(std::string name, std::function<bool(BackgroundJob&)> work)
+    : name_(std::move(name))
+{
+    // A thread of its own rather than a pool job: the work still fans out over
+    // the pool through parallelFor, but with NMD_THREADS=1 (no pool workers) it
+    // would otherwise run right here and stall the caller
+    result_ = std::async(std::launch::async, [this, work]() { return work(*this); });
+}
+
+BackgroundJob::~BackgroundJob()
+{
+    if (result_.valid()) {
+        result_.wait();
+    }
+}
+
+bool BackgroundJob::finished() const
+{
+    return result_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool BackgroundJob::succeeded()
+{
+    return result_.get();
+}
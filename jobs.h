@@ -0,0 +1,45 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <string>
+
+// One unit of background work on its own thread, polled by the render loop.
+// The work function reports progress and checks for cancellation between its
+// steps; it returns false if it gave up without a result.
+class BackgroundJob {
+public:
+    BackgroundJob(std::string name, std::function<bool(BackgroundJob&)> work);
+
+    // Waits for the work to finish (a running job cannot be abandoned)
+    ~BackgroundJob();
+
+    BackgroundJob(const BackgroundJob&) = delete;
+    BackgroundJob& operator=(const BackgroundJob&) = delete;
+
+    const std::string& name() const { return name_; }
+
+    // Fraction done, 0..1 (written by the work, read by the UI)
+    float progress() const { return progress_.load(std::memory_order_relaxed); }
+    void setProgress(float progress) { progress_.store(progress, std::memory_order_relaxed); }
+
+    // Ask the work to stop at its next check
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    // True once the work has returned; never blocks
+    bool finished() const;
+
+    // Result of the work (true = completed and applied). Only call once finished.
+    bool succeeded();
+
+private:
+    std::string name_;
+    std::atomic<float> progress_{0.0f};
+    std::atomic<bool> cancelled_{false};
+    std::future<bool> result_;
+};
+
+#endif
@@ -5,14 +5,32 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 #include <dirent.h>
 
 #include "mesh.h"
+#include "components.h"
+#include "decimate.h"
+#include "denoise.h"
+#include "history.h"
+#include "jobs.h"
+#include "mesh_cache.h"
+#include "parallel.h"
+#include "render.h"
+#include "repair.h"
 #include "shader.h"
+#include "smooth.h"
+#include "trace.h"
 #include "ui.h"
+#include "weld.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
@@ -36,6 +54,57 @@ float yaw = 90.0f;
 float pitch = 0.0f;
 float fov   =  45.0f;
 
+// Run edit on every mesh in the background. Each history hands out its working
+// mesh (moved when it can rebuild it, see MeshHistory::checkout); the results
+// are committed only if all meshes finish before a cancel, else restored.
+std::unique_ptr<BackgroundJob> startEditJob(const char* name, std::vector<MeshHistory>& histories,
+                                            std::function<void(Mesh&, const ProgressCallback&)> edit)
+{
+    return std::make_unique<BackgroundJob>(name, [&histories, edit](BackgroundJob& job) {
+        std::vector<Mesh> edited(histories.size());
+        const auto abandon = [&histories](size_t checkedOut) {
+            for (size_t i = 0; i < checkedOut; ++i) histories[i].restore();
+            return false;
+        };
+        for (size_t i = 0; i < histories.size(); ++i) {
+            if (job.cancelled()) {
+                return abandon(i);
+            }
+            // Long edits report per pass, so progress and cancel also work
+            // inside a single mesh
+            const ProgressCallback progress = [&job, i, count = histories.size()](float done) {
+                job.setProgress((i + std::min(std::max(done, 0.0f), 1.0f)) / count);
+                return !job.cancelled();
+            };
+            edited[i] = histories[i].checkout();
+            edit(edited[i], progress);
+            job.setProgress(static_cast<float>(i + 1) / histories.size());
+        }
+        if (job.cancelled()) {
+            return abandon(histories.size());
+        }
+        for (size_t i = 0; i < histories.size(); ++i) {
+            histories[i].commit(std::move(edited[i]));
+        }
+        return true;
+    });
+}
+
+// Step every history (undo/redo/reset) in the background. Not cancellable:
+// stopping half way would leave the meshes at different steps.
+std::unique_ptr<BackgroundJob> startHistoryJob(const char* name, std::vector<MeshHistory>& histories,
+                                               std::function<bool(MeshHistory&)> step)
+{
+    return std::make_unique<BackgroundJob>(name, [&histories, step](BackgroundJob& job) {
+        bool changed = false;
+        for (size_t i = 0; i < histories.size(); ++i) {
+            changed |= step(histories[i]);
+            job.setProgress(static_cast<float>(i + 1) / histories.size());
+        }
+        return changed;
+    });
+}
+
 
 int main()
 {
@@ -98,32 +167,66 @@ int main()
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    // Load all OBJ files from meshDir directory
-    std::vector<Mesh> meshes;
-    std::vector<Mesh> originalMeshes;  // Store originals for reset
+    // Load all OBJ files from meshDir directory (sorted, so mesh order is stable)
+    std::vector<MeshHistory> histories;  // Loaded meshes and their edits (undo/redo/reset)
+    std::vector<RenderMesh> renderMeshes;  // GPU buffers, one per mesh
     std::string meshDir = "mesh/hotdog/";
-    
+    std::vector<std::string> meshFiles;
+
     DIR* dir = opendir(meshDir.c_str());
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        std::string filename = entry->d_name;
-        if (filename.length() > 4 && filename.substr(filename.length() - 4) == ".obj") {
-            meshes.push_back(loadOBJ(meshDir + filename));
+    if (!dir) {
+        std::cerr << "Failed to open mesh directory: " << meshDir << std::endl;
+    } else {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string filename = entry->d_name;
+            if (filename.length() > 4 && filename.substr(filename.length() - 4) == ".obj") {
+                meshFiles.push_back(meshDir + filename);
+            }
         }
+        closedir(dir);
     }
-    closedir(dir);
+    std::sort(meshFiles.begin(), meshFiles.end());
 
-    // Store original meshes for reset functionality
-    originalMeshes = meshes;
-
-    // Prepare OpenGL VBO for each mesh (with initial selection highlighted)
-    for (auto& mesh : meshes) {
-        prepareMeshForGL(mesh, uiState.boundarySelection);
+    // Files are parsed concurrently on the thread pool; each mesh is uploaded
+    // to the GPU here (GL calls stay on this thread) as soon as it is ready
+    std::vector<std::future<Mesh>> pendingLoads;
+    for (const std::string& file : meshFiles) {
+        pendingLoads.push_back(defaultThreadPool().submit([file]() { return loadMesh(file); }));
+    }
+    std::vector<Mesh> loadedMeshes(meshFiles.size());
+    std::vector<bool> uploaded(meshFiles.size(), false);
+    renderMeshes.resize(meshFiles.size());
+    size_t remaining = meshFiles.size();
+    while (remaining > 0) {
+        for (size_t i = 0; i < pendingLoads.size(); ++i) {
+            if (uploaded[i] || pendingLoads[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                continue;
+            }
+            loadedMeshes[i] = pendingLoads[i].get();
+            prepareMeshForGL(loadedMeshes[i], renderMeshes[i]);
+            uploaded[i] = true;
+            remaining--;
+        }
+        if (remaining > 0) {
+            glfwPollEvents();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    for (Mesh& mesh : loadedMeshes) {
+        histories.emplace_back(std::move(mesh));
+    }
+    // History revision each GPU mesh was last uploaded from
+    std::vector<uint64_t> uploadedRevision;
+    for (const MeshHistory& history : histories) {
+        uploadedRevision.push_back(history.revision());
     }
 
     // Matrices and uniform locations
     glm::mat4 modelMatrix = glm::mat4(1.0f);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
     unsigned int modelLoc = glGetUniformLocation(shaderProgram, "modelMatrix");
+    unsigned int normalMatrixLoc = glGetUniformLocation(shaderProgram, "normalMatrix");
     unsigned int viewLoc = glGetUniformLocation(shaderProgram, "viewMatrix");
     unsigned int projLoc = glGetUniformLocation(shaderProgram, "projectionMatrix");
     
@@ -132,38 +235,129 @@ int main()
     unsigned int viewPosLoc = glGetUniformLocation(shaderProgram, "viewPos");
     unsigned int objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
     unsigned int boundaryColorLoc = glGetUniformLocation(shaderProgram, "boundaryColor");
+    unsigned int highlightClassLoc = glGetUniformLocation(shaderProgram, "highlightClass");
+
+    // At most one background job runs at a time; histories are only touched
+    // by it while it runs
+    std::unique_ptr<BackgroundJob> activeJob;
+
+    // Per-face streams are bound to fixed texture units by drawMesh
+    glUseProgram(shaderProgram);
+    glUniform1i(glGetUniformLocation(shaderProgram, "faceNormals"), kFaceNormalTextureUnit);
+    glUniform1i(glGetUniformLocation(shaderProgram, "faceClasses"), kFaceClassTextureUnit);
 
     while (!glfwWindowShouldClose(window))
     {
+        TRACE_ZONE("frame");
         processInput(window);
 
-        // Handle UI button clicks
-        if (uiState.removeClicked) {
-            uiState.removeClicked = false;
-            for (auto& mesh : meshes) {
-                removeBoundaryFaces(mesh, uiState.boundarySelection);
-                prepareMeshForGL(mesh, uiState.boundarySelection);
+        // Handle UI button clicks. Edits run as background jobs on copies of the
+        // meshes; this thread only uploads the results, all in the same frame.
+        if (!activeJob) {
+            if (uiState.removeClicked) {
+                const int selection = uiState.boundarySelection;
+                activeJob = startEditJob("Removing boundary faces", histories,
+                    [selection](Mesh& mesh, const ProgressCallback&) {
+                        removeBoundaryFaces(mesh, selection);
+                        removeUnusedVertices(mesh);
+                    });
+            } else if (uiState.peelClicked) {
+                const int selection = uiState.boundarySelection;
+                const int maxIterations = uiState.peelMaxIterations;
+                activeJob = startEditJob("Peeling", histories,
+                    [selection, maxIterations](Mesh& mesh, const ProgressCallback& progress) {
+                        peelBoundaryFaces(mesh, selection, maxIterations, progress);
+                        removeUnusedVertices(mesh);
+                    });
+            } else if (uiState.removeFloatersClicked) {
+                const int minFaces = uiState.floaterMinFaces;
+                activeJob = startEditJob("Removing floaters", histories,
+                    [minFaces](Mesh& mesh, const ProgressCallback&) {
+                        removeSmallComponents(mesh, minFaces);
+                        removeUnusedVertices(mesh);
+                    });
+            } else if (uiState.weldClicked) {
+                const float epsilon = uiState.weldEpsilon;
+                activeJob = startEditJob("Welding", histories,
+                    [epsilon](Mesh& mesh, const ProgressCallback&) {
+                        weldVertices(mesh, epsilon);
+                    });
+            } else if (uiState.denoiseClicked) {
+                DenoiseSettings settings;
+                settings.normalIterations = uiState.denoiseIterations;
+                settings.sigmaNormal = uiState.denoiseSigma;
+                activeJob = startEditJob("Denoising", histories,
+                    [settings](Mesh& mesh, const ProgressCallback& progress) {
+                        denoiseMesh(mesh, settings, progress);
+                    });
+            } else if (uiState.smoothClicked) {
+                TaubinSettings settings;
+                settings.iterations = uiState.smoothIterations;
+                settings.pinBoundary = uiState.smoothPinBoundary;
+                activeJob = startEditJob("Smoothing", histories,
+                    [settings](Mesh& mesh, const ProgressCallback& progress) {
+                        taubinSmooth(mesh, settings, progress);
+                    });
+            } else if (uiState.decimateClicked) {
+                DecimateSettings settings;
+                settings.targetFaces = uiState.decimateTargetFaces;
+                settings.preserveBoundary = uiState.decimatePreserveBoundary;
+                activeJob = startEditJob("Decimating", histories,
+                    [settings](Mesh& mesh, const ProgressCallback& progress) {
+                        decimateMesh(mesh, settings, progress);
+                    });
+            } else if (uiState.repairClicked) {
+                RepairSettings settings;
+                settings.dropSmallFans = uiState.repairDropFans;
+                activeJob = startEditJob("Repairing", histories,
+                    [settings](Mesh& mesh, const ProgressCallback& progress) {
+                        repairNonManifold(mesh, settings, progress);
+                        removeUnusedVertices(mesh);
+                    });
+            } else if (uiState.resetClicked) {
+                activeJob = startHistoryJob("Resetting", histories, [](MeshHistory& history) {
+                    history.reset();
+                    return true;
+                });
+            } else if (uiState.undoClicked) {
+                activeJob = startHistoryJob("Undoing", histories, [](MeshHistory& history) { return history.undo(); });
+            } else if (uiState.redoClicked) {
+                activeJob = startHistoryJob("Redoing", histories, [](MeshHistory& history) { return history.redo(); });
             }
+        } else if (uiState.cancelClicked) {
+            activeJob->cancel();
         }
-        
-        // Rebuild VBO with new highlighting when selection changes
-        if (uiState.selectionChanged) {
-            uiState.selectionChanged = false;
-            for (auto& mesh : meshes) {
-                prepareMeshForGL(mesh, uiState.boundarySelection);
-            }
-        }
-        
-        if (uiState.resetClicked) {
-            uiState.resetClicked = false;
-            meshes = originalMeshes;
-            for (auto& mesh : meshes) {
-                // not completed
-                prepareMeshForGL(mesh, uiState.boundarySelection);
+        // Clicks made while a job runs are dropped, not queued
+        uiState.removeClicked = false;
+        uiState.peelClicked = false;
+        uiState.removeFloatersClicked = false;
+        uiState.weldClicked = false;
+        uiState.denoiseClicked = false;
+        uiState.smoothClicked = false;
+        uiState.decimateClicked = false;
+        uiState.repairClicked = false;
+        uiState.resetClicked = false;
+        uiState.undoClicked = false;
+        uiState.redoClicked = false;
+        uiState.cancelClicked = false;
+
+        if (activeJob && activeJob->finished()) {
+            // Re-upload only meshes the job changed. GPU buffers are reused;
+            // only their contents are replaced
+            for (size_t i = 0; i < histories.size(); ++i) {
+                if (histories[i].revision() != uploadedRevision[i]) {
+                    prepareMeshForGL(histories[i].current(), renderMeshes[i]);
+                    uploadedRevision[i] = histories[i].revision();
+                }
             }
+            activeJob.reset();
         }
+        uiState.jobRunning = activeJob != nullptr;
+        uiState.jobName = activeJob ? activeJob->name().c_str() : "";
+        uiState.jobProgress = activeJob ? activeJob->progress() : 0.0f;
 
         // Render
+        TRACE_ZONE("draw");
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -174,6 +368,7 @@ int main()
 
         // Pass matrices to shader
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
         glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(viewMatrix));
         glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
         
@@ -204,10 +399,12 @@ int main()
         glUniform3fv(objectColorLoc, 1, objectColor);
         glUniform3fv(boundaryColorLoc, 1, boundaryColor);
 
+        // Selection changes only switch the highlighted class; no buffers are rebuilt
+        glUniform1i(highlightClassLoc, uiState.boundarySelection + 1);
+
         // Draw all loaded meshes
-        for (const auto& mesh : meshes) {
-            glBindVertexArray(mesh.VAO);
-            glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount);
+        for (const auto& renderMesh : renderMeshes) {
+            drawMesh(renderMesh);
         }
 
         // Render UI
@@ -218,10 +415,10 @@ int main()
     }
 
     // Cleanup
+    TRACE_EXPORT("nmd_trace.json");
     shutdownUI();
-    for (auto& mesh : meshes) {
-        glDeleteVertexArrays(1, &mesh.VAO);
-        glDeleteBuffers(1, &mesh.VBO);
+    for (auto& renderMesh : renderMeshes) {
+        releaseMeshGL(renderMesh);
     }
     glDeleteProgram(shaderProgram);
 
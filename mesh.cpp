@@ -1,19 +1,20 @@
 #include "mesh.h"
+#include "mapped_file.h"
+#include "normals.h"
+#include "obj_parser.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <unordered_map>
-#include <unordered_set>
-
-// Hash for glm::vec3 (exact coordinate matching)
-struct Vec3Hash {
-    size_t operator()(const glm::vec3& v) const {
-        size_t h1 = std::hash<float>()(v.x);
-        size_t h2 = std::hash<float>()(v.y);
-        size_t h3 = std::hash<float>()(v.z);
-        return h1 ^ (h2 << 1) ^ (h3 << 2);
-    }
-};
 
 struct Vec3Equal {
     bool operator()(const glm::vec3& a, const glm::vec3& b) const {
@@ -21,30 +22,64 @@ struct Vec3Equal {
     }
 };
 
-Mesh loadOBJ(const std::string& path)
+// Strong hash of the exact coordinate bits. +0 and -0 hash alike since
+// Vec3Equal treats them as the same position.
+static uint64_t hashPosition(const glm::vec3& v)
 {
-    Mesh mesh;
-    
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    for (float c : {v.x, v.y, v.z}) {
+        if (c == 0.0f) c = 0.0f;
+        uint32_t bits;
+        std::memcpy(&bits, &c, sizeof(bits));
+        h = (h ^ bits) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 29);
+}
+
+struct PositionHash {
+    size_t operator()(const glm::vec3& v) const {
+        return static_cast<size_t>(hashPosition(v));
+    }
+};
+
+// Append a triangle (face normals are computed in one batch after parsing)
+static void appendFace(Mesh& mesh, int i0, int i1, int i2)
+{
+    mesh.indices.push_back(i0);
+    mesh.indices.push_back(i1);
+    mesh.indices.push_back(i2);
+}
+
+// getline/istringstream parser
+static bool parseOBJStream(const std::string& path, Mesh& mesh, int& rawVertexCount, size_t& bytesRead)
+{
+    TRACE_FUNCTION();
     std::ifstream file(path);
     if (!file.is_open()) {
-        std::cerr << "Failed to open: " << path << std::endl;
-        return mesh;
+        return false;
     }
     
     // vertex position - index pair 
-    std::unordered_map<glm::vec3, int, Vec3Hash, Vec3Equal> verticesMap;
+    std::unordered_map<glm::vec3, int, PositionHash, Vec3Equal> verticesMap;
     
     // index mapping from old (duplicated vertices in original file) to new (unique vertices in verticesMap)
     std::vector<int> oldToNewIndex;
     
-    int rawVertexCount = 0;
+    // OBJ indices (0-based) of every face; resolved once all vertices are
+    // known, so faces are validated exactly like the mapped parser does
+    std::vector<int> faces;
+    int invalidFaces = 0;
+
     std::string line;
     
     while (std::getline(file, line)) {
+        bytesRead += line.size() + 1;
         if (line.substr(0, 2) == "v ") {
-            // Parse vertex position
+            // Parse vertex position (missing coordinates are 0)
             std::istringstream iss(line.substr(2));
-            float x, y, z;
+            float x = 0.0f, y = 0.0f, z = 0.0f;
             iss >> x >> y >> z;
             glm::vec3 pos(x, y, z);
             
@@ -63,107 +98,616 @@ Mesh loadOBJ(const std::string& path)
             rawVertexCount++;
         } 
         else if (line.substr(0, 2) == "f ") {
-            // Parse triangle face
+            // Parse triangle face; a token without a number ends it
             std::istringstream iss(line.substr(2));
             std::string token;
             int indices[3];
+            int count = 0;
             
-            for (int i = 0; i < 3 && iss >> token; ++i) {
+            while (count < 3 && iss >> token) {
                 size_t pos = token.find('/');
                 if (pos != std::string::npos) {
                     token = token.substr(0, pos);
                 }
-                int objIdx = std::stoi(token) - 1;
-                indices[i] = oldToNewIndex[objIdx];
+                try {
+                    indices[count] = std::stoi(token) - 1;
+                } catch (const std::invalid_argument&) {
+                    break;
+                } catch (const std::out_of_range&) {
+                    indices[count] = -1;    // Rejected with the range check below
+                }
+                count++;
             }
-            
-            mesh.indices.push_back(indices[0]);
-            mesh.indices.push_back(indices[1]);
-            mesh.indices.push_back(indices[2]);
-            
-            // Compute face normal
-            glm::vec3 v0 = mesh.vertices[indices[0]];
-            glm::vec3 v1 = mesh.vertices[indices[1]];
-            glm::vec3 v2 = mesh.vertices[indices[2]];
-            glm::vec3 edge1 = v1 - v0;
-            glm::vec3 edge2 = v2 - v0;
-            glm::vec3 normal = glm::normalize(glm::cross(edge1, edge2));
-            
-            mesh.faceNormals.push_back(normal);
+            if (count < 3) {
+                invalidFaces++;
+                continue;
+            }
+            faces.insert(faces.end(), indices, indices + 3);
+        }
+    }
+
+    mesh.indices.reserve(faces.size());
+    for (size_t f = 0; f + 2 < faces.size(); f += 3) {
+        const int* objIdx = &faces[f];
+        if (objIdx[0] < 0 || objIdx[0] >= rawVertexCount ||
+            objIdx[1] < 0 || objIdx[1] >= rawVertexCount ||
+            objIdx[2] < 0 || objIdx[2] >= rawVertexCount) {
+            invalidFaces++;
+            continue;
+        }
+        appendFace(mesh, oldToNewIndex[objIdx[0]], oldToNewIndex[objIdx[1]], oldToNewIndex[objIdx[2]]);
+    }
+    if (invalidFaces > 0) {
+        std::cerr << "Skipped " << invalidFaces << " malformed faces in " << path << std::endl;
+    }
+    return true;
+}
+
+// mmap parser: scan records in place, then weld exactly like the stream parser
+static bool parseOBJMapped(const std::string& path, Mesh& mesh, int& rawVertexCount, size_t& bytesRead)
+{
+    TRACE_FUNCTION();
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        return false;
+    }
+    bytesRead = file.size();
+
+    OBJRecords records;
+    parseOBJRecords(file.data(), file.data() + file.size(), records);
+    rawVertexCount = static_cast<int>(records.positions.size());
+
+    // vertex position - index pair 
+    std::unordered_map<glm::vec3, int, PositionHash, Vec3Equal> verticesMap;
+    verticesMap.reserve(records.positions.size());
+    std::vector<int> oldToNewIndex;
+    oldToNewIndex.reserve(records.positions.size());
+
+    for (const glm::vec3& pos : records.positions) {
+        auto [it, inserted] = verticesMap.try_emplace(pos, static_cast<int>(mesh.vertices.size()));
+        if (inserted) {
+            mesh.vertices.push_back(pos);
+        }
+        oldToNewIndex.push_back(it->second);
+    }
+
+    size_t numFaces = records.faces.size() / 3;
+    mesh.indices.reserve(numFaces * 3);
+
+    int invalidFaces = records.skippedFaces;
+    for (size_t f = 0; f < numFaces; ++f) {
+        const int* objIdx = &records.faces[f * 3];
+        if (objIdx[0] < 0 || objIdx[0] >= rawVertexCount ||
+            objIdx[1] < 0 || objIdx[1] >= rawVertexCount ||
+            objIdx[2] < 0 || objIdx[2] >= rawVertexCount) {
+            invalidFaces++;
+            continue;
+        }
+        appendFace(mesh, oldToNewIndex[objIdx[0]], oldToNewIndex[objIdx[1]], oldToNewIndex[objIdx[2]]);
+    }
+    if (invalidFaces > 0) {
+        std::cerr << "Skipped " << invalidFaces << " malformed faces in " << path << std::endl;
+    }
+    return true;
+}
+
+// Parallel version of the verticesMap dedup. Raw vertices are bucketed by
+// hash into shards (keeping file order inside each shard), every shard finds
+// the first occurrence of each position, and new indices are handed out in
+// first-occurrence order - the same numbering the serial loop produces.
+// Returns the raw -> unique index map.
+static std::vector<int> weldExactParallel(const std::vector<glm::vec3>& positions, std::vector<glm::vec3>& unique)
+{
+    TRACE_FUNCTION();
+    const size_t n = positions.size();
+    const size_t blockSize = 1 << 16;
+    const size_t numBlocks = std::max<size_t>(1, (n + blockSize - 1) / blockSize);
+    const size_t numShards = std::min<size_t>(parallelism() * 8, 65535);
+
+    // Shard histogram per block
+    std::vector<uint16_t> shardOf(n);
+    std::vector<size_t> offsets(numBlocks * numShards, 0);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            size_t* counts = &offsets[b * numShards];
+            for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); ++i) {
+                uint16_t shard = static_cast<uint16_t>((hashPosition(positions[i]) >> 40) % numShards);
+                shardOf[i] = shard;
+                counts[shard]++;
+            }
+        }
+    });
+
+    // Shard-major exclusive prefix sum: each shard gets a contiguous range
+    // that lists its raw vertices in file order
+    std::vector<size_t> shardStart(numShards + 1, 0);
+    size_t running = 0;
+    for (size_t s = 0; s < numShards; ++s) {
+        shardStart[s] = running;
+        for (size_t b = 0; b < numBlocks; ++b) {
+            size_t count = offsets[b * numShards + s];
+            offsets[b * numShards + s] = running;
+            running += count;
+        }
+    }
+    shardStart[numShards] = running;
+
+    std::vector<int> order(n);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            size_t* cursor = &offsets[b * numShards];
+            for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); ++i) {
+                order[cursor[shardOf[i]]++] = static_cast<int>(i);
+            }
+        }
+    });
+
+    // First raw occurrence of every position
+    std::vector<int> firstOccurrence(n);
+    parallelFor(numShards, 1, [&](size_t shardBegin, size_t shardEnd) {
+        for (size_t s = shardBegin; s < shardEnd; ++s) {
+            std::unordered_map<glm::vec3, int, PositionHash, Vec3Equal> seen;
+            seen.reserve(shardStart[s + 1] - shardStart[s]);
+            for (size_t k = shardStart[s]; k < shardStart[s + 1]; ++k) {
+                int raw = order[k];
+                firstOccurrence[raw] = seen.try_emplace(positions[raw], raw).first->second;
+            }
+        }
+    });
+
+    // Number first occurrences in file order (block-wise prefix sum)
+    std::vector<int> blockFirsts(numBlocks + 1, 0);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            int count = 0;
+            for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); ++i) {
+                count += (firstOccurrence[i] == static_cast<int>(i));
+            }
+            blockFirsts[b + 1] = count;
         }
+    });
+    for (size_t b = 0; b < numBlocks; ++b) {
+        blockFirsts[b + 1] += blockFirsts[b];
     }
+
+    std::vector<int> oldToNewIndex(n);
+    unique.resize(blockFirsts[numBlocks]);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            int next = blockFirsts[b];
+            for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); ++i) {
+                if (firstOccurrence[i] == static_cast<int>(i)) {
+                    unique[next] = positions[i];
+                    oldToNewIndex[i] = next++;
+                }
+            }
+        }
+    });
+    // Duplicates point at an earlier raw vertex, numbered in the pass above
+    parallelFor(n, blockSize, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (firstOccurrence[i] != static_cast<int>(i)) {
+                oldToNewIndex[i] = oldToNewIndex[firstOccurrence[i]];
+            }
+        }
+    });
+    return oldToNewIndex;
+}
+
+// Chunked parallel parser: newline-aligned chunks are scanned on the thread
+// pool, then welded and resolved in parallel. Output matches parseOBJMapped.
+static bool parseOBJParallel(const std::string& path, Mesh& mesh, int& rawVertexCount, size_t& bytesRead)
+{
+    TRACE_FUNCTION();
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        return false;
+    }
+    bytesRead = file.size();
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    // Chunks of at least 1 MB, split right after a newline
+    const size_t minChunkBytes = 1 << 20;
+    const size_t numChunks = std::max<size_t>(1, std::min<size_t>(parallelism() * 4, size / minChunkBytes));
+    std::vector<const char*> bounds(numChunks + 1, data + size);
+    bounds[0] = data;
+    for (size_t c = 1; c < numChunks; ++c) {
+        const char* p = data + size * c / numChunks;
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(data + size - p)));
+        bounds[c] = newline ? newline + 1 : data + size;
+    }
+
+    std::vector<OBJRecords> chunks(numChunks);
+    parallelFor(numChunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            TRACE_ZONE("parse chunk");
+            parseOBJRecords(bounds[c], bounds[c + 1], chunks[c]);
+        }
+    });
+
+    // Concatenate raw positions in file order
+    std::vector<size_t> vertexOffset(numChunks + 1, 0);
+    for (size_t c = 0; c < numChunks; ++c) {
+        vertexOffset[c + 1] = vertexOffset[c] + chunks[c].positions.size();
+    }
+    std::vector<glm::vec3> positions(vertexOffset[numChunks]);
+    parallelFor(numChunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            std::copy(chunks[c].positions.begin(), chunks[c].positions.end(), positions.begin() + vertexOffset[c]);
+            std::vector<glm::vec3>().swap(chunks[c].positions);
+        }
+    });
+    rawVertexCount = static_cast<int>(positions.size());
+
+    std::vector<int> oldToNewIndex = weldExactParallel(positions, mesh.vertices);
+    std::vector<glm::vec3>().swap(positions);
+
+    // Count well-formed faces per chunk to find each chunk's output range
+    auto isValid = [rawVertexCount](const int* objIdx) {
+        return objIdx[0] >= 0 && objIdx[0] < rawVertexCount &&
+               objIdx[1] >= 0 && objIdx[1] < rawVertexCount &&
+               objIdx[2] >= 0 && objIdx[2] < rawVertexCount;
+    };
+    std::vector<size_t> faceOffset(numChunks + 1, 0);
+    parallelFor(numChunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            size_t valid = 0;
+            for (size_t f = 0; f < chunks[c].faces.size(); f += 3) {
+                valid += isValid(&chunks[c].faces[f]);
+            }
+            faceOffset[c + 1] = valid;
+        }
+    });
+    int invalidFaces = 0;
+    for (size_t c = 0; c < numChunks; ++c) {
+        invalidFaces += chunks[c].skippedFaces + static_cast<int>(chunks[c].faces.size() / 3 - faceOffset[c + 1]);
+        faceOffset[c + 1] += faceOffset[c];
+    }
+
+    mesh.indices.resize(faceOffset[numChunks] * 3);
+    parallelFor(numChunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            size_t out = faceOffset[c];
+            for (size_t f = 0; f < chunks[c].faces.size(); f += 3) {
+                const int* objIdx = &chunks[c].faces[f];
+                if (!isValid(objIdx)) continue;
+                mesh.indices[out * 3 + 0] = oldToNewIndex[objIdx[0]];
+                mesh.indices[out * 3 + 1] = oldToNewIndex[objIdx[1]];
+                mesh.indices[out * 3 + 2] = oldToNewIndex[objIdx[2]];
+                out++;
+            }
+        }
+    });
+    if (invalidFaces > 0) {
+        std::cerr << "Skipped " << invalidFaces << " malformed faces in " << path << std::endl;
+    }
+    return true;
+}
+
+Mesh loadOBJ(const std::string& path, OBJLoadMode mode)
+{
+    TRACE_FUNCTION();
+    Mesh mesh;
+    int rawVertexCount = 0;
+    size_t bytesRead = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    bool opened = false;
+    const char* modeName = "";
+    switch (mode) {
+    case OBJLoadMode::Stream:
+        opened = parseOBJStream(path, mesh, rawVertexCount, bytesRead);
+        modeName = "stream";
+        break;
+    case OBJLoadMode::Mapped:
+        opened = parseOBJMapped(path, mesh, rawVertexCount, bytesRead);
+        modeName = "mapped";
+        break;
+    case OBJLoadMode::Parallel:
+        opened = parseOBJParallel(path, mesh, rawVertexCount, bytesRead);
+        modeName = "parallel";
+        break;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (!opened) {
+        std::cerr << "Failed to open: " << path << std::endl;
+        return mesh;
+    }
+
+    TRACE_COUNT(trace::Counter::BytesParsed, bytesRead);
+    TRACE_COUNT(trace::Counter::FacesProcessed, mesh.indices.size() / 3);
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double megabytes = bytesRead / (1024.0 * 1024.0);
+    std::cout << "parsed " << megabytes << " MB in " << seconds * 1000.0 << " ms ("
+     << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MB/s, "
+     << modeName << ")\n";
     
     std::cout << "loaded OBJ file and removed duplicates: \n"
      << "vertices including duplicates: " << rawVertexCount
      << "\nvertices excluding duplicates: " << mesh.vertices.size() 
      << "\ntriangles " << mesh.indices.size() / 3 << std::endl;
 
+    computeFaceNormals(mesh);
     mesh.edgeToFaces = buildEdgeFaceAdjacency(mesh);
+    mesh.halfEdges = buildHalfEdges(mesh);
     analyzeMesh(mesh.edgeToFaces);
     findBoundaryFaces(mesh);
 
     return mesh;
 }
 
-std::map<Edge, std::vector<int>> buildEdgeFaceAdjacency(const Mesh& mesh) {
-    std::map<Edge, std::vector<int>> edgeToFaces;
-    
-    size_t numTriangles = mesh.indices.size() / 3;
-    for (size_t faceIdx = 0; faceIdx < numTriangles; ++faceIdx) {
-        int v0 = mesh.indices[faceIdx * 3 + 0];
-        int v1 = mesh.indices[faceIdx * 3 + 1];
-        int v2 = mesh.indices[faceIdx * 3 + 2];
-        
-        edgeToFaces[makeEdge(v0, v1)].push_back(faceIdx);
-        edgeToFaces[makeEdge(v1, v2)].push_back(faceIdx);
-        edgeToFaces[makeEdge(v2, v0)].push_back(faceIdx);
+int EdgeTable::find(int v0, int v1) const
+{
+    EdgeKey key = makeEdgeKey(v0, v1);
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it == keys.end() || *it != key) {
+        return -1;
     }
+    return static_cast<int>(it - keys.begin());
+}
+
+bool saveOBJ(const Mesh& mesh, const std::string& path)
+{
+    TRACE_FUNCTION();
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        std::cerr << "Failed to open for writing: " << path << std::endl;
+        return false;
+    }
+    // %.9g round-trips every float exactly
+    for (const glm::vec3& v : mesh.vertices) {
+        std::fprintf(file, "v %.9g %.9g %.9g\n", v.x, v.y, v.z);
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        std::fprintf(file, "f %d %d %d\n", mesh.indices[i] + 1, mesh.indices[i + 1] + 1, mesh.indices[i + 2] + 1);
+    }
+    bool ok = std::ferror(file) == 0;
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Failed to write: " << path << std::endl;
+    }
+    return ok;
+}
+
+EdgeTable buildEdgeFaceAdjacency(const Mesh& mesh) {
+    TRACE_FUNCTION();
+    EdgeTable edgeToFaces;
+    const size_t numCorners = mesh.indices.size() / 3 * 3;
+    const size_t grain = 1 << 14;
+
+    // Sort keys only need enough bits for the vertex count:
+    // (smaller << vertexBits) | larger orders edges like the 64-bit EdgeKey
+    int vertexBits = 1;
+    while (vertexBits < 32 && (size_t(1) << vertexBits) < mesh.vertices.size()) {
+        vertexBits++;
+    }
+    const uint64_t lowMask = (uint64_t(1) << vertexBits) - 1;
+
+    // One (edge, corner) pair per triangle edge, emitted in corner order
+    std::vector<uint64_t> sortKeys(numCorners);
+    std::vector<int> corners(numCorners);
+    parallelFor(numCorners, grain, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            uint32_t v0 = static_cast<uint32_t>(mesh.indices[c]);
+            uint32_t v1 = static_cast<uint32_t>(mesh.indices[c % 3 == 2 ? c - 2 : c + 1]);
+            sortKeys[c] = (uint64_t(std::min(v0, v1)) << vertexBits) | std::max(v0, v1);
+            corners[c] = static_cast<int>(c);
+        }
+    });
+
+    // Stable sort: each edge's faces stay in face order, like the old map inserts
+    parallelRadixSort(sortKeys, corners, vertexBits * 2);
+
+    // Edge id of every sorted pair: prefix sum of run starts, block by block
+    const size_t numBlocks = (numCorners + grain - 1) / grain;
+    std::vector<int> blockEdges(numBlocks + 1, 0);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            int starts = 0;
+            for (size_t i = b * grain; i < std::min(numCorners, (b + 1) * grain); ++i) {
+                starts += (i == 0 || sortKeys[i] != sortKeys[i - 1]);
+            }
+            blockEdges[b + 1] = starts;
+        }
+    });
+    for (size_t b = 0; b < numBlocks; ++b) {
+        blockEdges[b + 1] += blockEdges[b];
+    }
+
+    const int numEdges = blockEdges[numBlocks];
+    edgeToFaces.keys.resize(numEdges);
+    edgeToFaces.offsets.resize(numEdges + 1);
+    edgeToFaces.offsets[numEdges] = static_cast<int>(numCorners);
+    edgeToFaces.faces.resize(numCorners);
+    edgeToFaces.cornerEdges.resize(numCorners);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            int edge = blockEdges[b] - 1;
+            for (size_t i = b * grain; i < std::min(numCorners, (b + 1) * grain); ++i) {
+                if (i == 0 || sortKeys[i] != sortKeys[i - 1]) {
+                    edge++;
+                    uint64_t key = sortKeys[i];
+                    edgeToFaces.keys[edge] = (EdgeKey(key >> vertexBits) << 32) | (key & lowMask);
+                    edgeToFaces.offsets[edge] = static_cast<int>(i);
+                }
+                edgeToFaces.faces[i] = corners[i] / 3;
+                edgeToFaces.cornerEdges[corners[i]] = edge;
+            }
+        }
+    });
     return edgeToFaces;
 }
 
-void analyzeMesh(const std::map<Edge, std::vector<int>>& edgeToFaces) {
-    int boundaryEdges = 0;
-    int manifoldEdges = 0;
-    int nonManifoldEdges_3 = 0;
-    int nonManifoldEdges_4 = 0;
-    int nonManifoldEdges = 0;
+// Other corner of a two-face edge, or the boundary / non-manifold marker
+static int findTwin(const EdgeTable& edges, int corner) {
+    int edge = edges.cornerEdges[corner];
+    int count = edges.faceCount(edge);
+    if (count == 1) {
+        return kBoundaryHalfEdge;
+    }
+    if (count > 2) {
+        return kNonManifoldHalfEdge;
+    }
+    const int* faces = edges.facesBegin(edge);
+    int other = faces[0] == corner / 3 ? faces[1] : faces[0];
+    for (int i = 0; i < 3; ++i) {
+        int candidate = other * 3 + i;
+        if (candidate != corner && edges.cornerEdges[candidate] == edge) {
+            return candidate;
+        }
+    }
+    return kNonManifoldHalfEdge;
+}
+
+HalfEdges buildHalfEdges(const Mesh& mesh) {
+    TRACE_FUNCTION();
+    HalfEdges halfEdges;
+    const EdgeTable& edges = mesh.edgeToFaces;
+    const int numCorners = static_cast<int>(edges.cornerEdges.size());
 
-    for (const auto& [edge, faceList] : edgeToFaces) {
-        size_t count = faceList.size();
+    // Twin of a corner: the other corner of a two-face edge
+    halfEdges.twins.resize(numCorners);
+    parallelFor(numCorners, 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            halfEdges.twins[c] = findTwin(edges, static_cast<int>(c));
+        }
+    });
+
+    // Vertex - outgoing corners (counting sort, corners stay in increasing order)
+    const size_t numVertices = mesh.vertices.size();
+    halfEdges.vertexOffsets.assign(numVertices + 1, 0);
+    for (int c = 0; c < numCorners; ++c) {
+        halfEdges.vertexOffsets[mesh.indices[c] + 1]++;
+    }
+    for (size_t v = 0; v < numVertices; ++v) {
+        halfEdges.vertexOffsets[v + 1] += halfEdges.vertexOffsets[v];
+    }
+    halfEdges.vertexCorners.resize(numCorners);
+    std::vector<int> cursor(halfEdges.vertexOffsets.begin(), halfEdges.vertexOffsets.end() - 1);
+    for (int c = 0; c < numCorners; ++c) {
+        halfEdges.vertexCorners[cursor[mesh.indices[c]]++] = c;
+    }
+    return halfEdges;
+}
+
+void vertexOneRing(const Mesh& mesh, int vertex, std::vector<int>& ring) {
+    ring.clear();
+    const HalfEdges& halfEdges = mesh.halfEdges;
+    for (const int* c = halfEdges.cornersBegin(vertex); c != halfEdges.cornersEnd(vertex); ++c) {
+        for (int neighbor : {mesh.indices[nextHalfEdge(*c)], mesh.indices[prevHalfEdge(*c)]}) {
+            if (neighbor != vertex && std::find(ring.begin(), ring.end(), neighbor) == ring.end()) {
+                ring.push_back(neighbor);
+            }
+        }
+    }
+}
+
+// Boundary half-edge that continues the loop after boundary half-edge h:
+// rotate around h's end vertex through manifold, consistently oriented faces.
+// Returns -1 if the walk hits a non-manifold edge or a flipped face.
+static int nextBoundaryHalfEdge(const Mesh& mesh, int h) {
+    const HalfEdges& halfEdges = mesh.halfEdges;
+    int pivot = mesh.indices[nextHalfEdge(h)];
+    int maxSteps = halfEdges.vertexOffsets[pivot + 1] - halfEdges.vertexOffsets[pivot];
+    int g = nextHalfEdge(h);
+    for (int step = 0; step <= maxSteps; ++step) {
+        int twin = halfEdges.twins[g];
+        if (twin == kBoundaryHalfEdge) {
+            return g;
+        }
+        if (twin == kNonManifoldHalfEdge || mesh.indices[twin] != mesh.indices[nextHalfEdge(g)]) {
+            return -1;
+        }
+        g = nextHalfEdge(twin);
+    }
+    return -1;
+}
+
+std::vector<std::vector<int>> findBoundaryLoops(const Mesh& mesh) {
+    TRACE_FUNCTION();
+    const std::vector<int>& twins = mesh.halfEdges.twins;
+    const int numHalfEdges = static_cast<int>(twins.size());
+
+    std::vector<int> next(numHalfEdges, -1);
+    std::vector<char> hasPrev(numHalfEdges, 0);
+    for (int h = 0; h < numHalfEdges; ++h) {
+        if (twins[h] == kBoundaryHalfEdge) {
+            next[h] = nextBoundaryHalfEdge(mesh, h);
+            if (next[h] >= 0) hasPrev[next[h]] = 1;
+        }
+    }
+
+    // Open chains first (from their first half-edge), then closed loops
+    std::vector<std::vector<int>> loops;
+    std::vector<char> visited(numHalfEdges, 0);
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int h0 = 0; h0 < numHalfEdges; ++h0) {
+            if (twins[h0] != kBoundaryHalfEdge || visited[h0] || (pass == 0 && hasPrev[h0])) {
+                continue;
+            }
+            std::vector<int> loop;
+            for (int h = h0; h >= 0 && !visited[h]; h = next[h]) {
+                visited[h] = 1;
+                loop.push_back(h);
+            }
+            loops.push_back(std::move(loop));
+        }
+    }
+    return loops;
+}
+
+EdgeStats analyzeMesh(const EdgeTable& edgeToFaces) {
+    TRACE_FUNCTION();
+    EdgeStats stats;
+
+    for (size_t edge = 0; edge < edgeToFaces.size(); ++edge) {
+        int count = edgeToFaces.faceCount(static_cast<int>(edge));
         
         if (count == 1) {
-            boundaryEdges++;
+            stats.boundaryEdges++;
         } else if (count == 2) {
-            manifoldEdges++;
+            stats.manifoldEdges++;
         } else if (count == 3) {
-            nonManifoldEdges_3++;
+            stats.nonManifoldEdges_3++;
         } else if (count == 4) {
-            nonManifoldEdges_4++;
+            stats.nonManifoldEdges_4++;
         } else {
-            nonManifoldEdges++;
+            stats.nonManifoldEdges++;
         }
     }
 
     std::cout << "Total edges: " << edgeToFaces.size() << "\n";
-    std::cout << "Boundary edges (1 face): " << boundaryEdges << "\n";
-    std::cout << "Manifold edges (2 faces): " << manifoldEdges << "\n";
-    std::cout << "Non-Manifold edges (3 faces): " << nonManifoldEdges_3 << "\n";
-    std::cout << "Non-Manifold edges (4 faces): " << nonManifoldEdges_4 << "\n";
-    std::cout << "Non-manifold edges (5+ faces): " << nonManifoldEdges << "\n";
+    std::cout << "Boundary edges (1 face): " << stats.boundaryEdges << "\n";
+    std::cout << "Manifold edges (2 faces): " << stats.manifoldEdges << "\n";
+    std::cout << "Non-Manifold edges (3 faces): " << stats.nonManifoldEdges_3 << "\n";
+    std::cout << "Non-Manifold edges (4 faces): " << stats.nonManifoldEdges_4 << "\n";
+    std::cout << "Non-manifold edges (5+ faces): " << stats.nonManifoldEdges << "\n";
+    return stats;
 }
 
-void findBoundaryFaces(Mesh& mesh) { 
-    int numTriangles = mesh.indices.size() / 3;
-    for (int faceIdx = 0; faceIdx < numTriangles; faceIdx++) {
-
-        int numBoundaryEdges = 0;
-        for (int i = 0; i < 3; i++) {  // Check all 3 edges
-            int v0 = mesh.indices[faceIdx * 3 + i];
-            int v1 = mesh.indices[faceIdx * 3 + (i + 1) % 3];  // Wrap around
-            if (mesh.edgeToFaces[makeEdge(v0, v1)].size() == 1) {
-                numBoundaryEdges++;
-            }
+// Number of edges of face with a single adjacent face
+static uint8_t countBoundaryEdges(const EdgeTable& edges, int faceIdx) {
+    uint8_t numBoundaryEdges = 0;
+    for (int i = 0; i < 3; i++) {  // Check all 3 edges
+        if (edges.faceCount(edges.cornerEdges[faceIdx * 3 + i]) == 1) {
+            numBoundaryEdges++;
         }
+    }
+    return numBoundaryEdges;
+}
+
+// Rebuild boundaryFaces_1/2/3 from mesh.boundaryClass
+static void collectBoundaryFaces(Mesh& mesh) {
+    TRACE_FUNCTION();
+    mesh.boundaryFaces_1.clear();
+    mesh.boundaryFaces_2.clear();
+    mesh.boundaryFaces_3.clear();
+    int numTriangles = static_cast<int>(mesh.boundaryClass.size());
+    for (int faceIdx = 0; faceIdx < numTriangles; faceIdx++) {
+        uint8_t numBoundaryEdges = mesh.boundaryClass[faceIdx];
         if (numBoundaryEdges == 1) {
             mesh.boundaryFaces_1.push_back(faceIdx);
         } else if (numBoundaryEdges == 2) {
@@ -172,119 +716,405 @@ void findBoundaryFaces(Mesh& mesh) {
             mesh.boundaryFaces_3.push_back(faceIdx);
         }
     }
+}
+
+static void printBoundaryFaces(const Mesh& mesh) {
     std::cout << "Boundary faces (1 edge): " << mesh.boundaryFaces_1.size() << "\n";
     std::cout << "Boundary faces (2 edge): " << mesh.boundaryFaces_2.size() << "\n";
     std::cout << "Boundary faces (3 edge): " << mesh.boundaryFaces_3.size() << "\n";
 }
 
+void findBoundaryFaces(Mesh& mesh) { 
+    TRACE_FUNCTION();
+    int numTriangles = mesh.indices.size() / 3;
+    mesh.boundaryClass.resize(numTriangles);
+    for (int faceIdx = 0; faceIdx < numTriangles; faceIdx++) {
+        mesh.boundaryClass[faceIdx] = countBoundaryEdges(mesh.edgeToFaces, faceIdx);
+    }
+    collectBoundaryFaces(mesh);
+    printBoundaryFaces(mesh);
+}
+
+// Buffers reused by every removeFaces call on a thread, so steady-state
+// removal does not touch the heap
+struct FaceRemovalScratch {
+    std::vector<uint64_t> removedMask;   // Bit f = face f is removed
+    std::vector<int> blockKept;          // Kept faces per block, then block output offsets
+    std::vector<int> faceRemap;
+    std::vector<char> edgeTouched;       // Old edge ids
+    std::vector<char> newEdgeTouched;    // Same flags on the compacted edge ids
+    std::vector<int> edgeRemap;
+};
+
+static FaceRemovalScratch& faceRemovalScratch() {
+    thread_local FaceRemovalScratch scratch;
+    return scratch;
+}
+
+// Faces per compaction block (a multiple of 64, so blocks cover whole mask words)
+constexpr size_t kCompactBlock = 1 << 14;
+
+static bool isFaceRemoved(const std::vector<uint64_t>& mask, size_t f) {
+    return (mask[f >> 6] >> (f & 63)) & 1;
+}
+
+// Old -> new face ids for the faces whose mask bit is clear (-1 = removed).
+// blockKept receives each block's output offset. Returns the kept count.
+static int buildFaceRemap(const std::vector<uint64_t>& mask, size_t numFaces,
+                   std::vector<int>& blockKept, std::vector<int>& faceRemap) {
+    const size_t numBlocks = (numFaces + kCompactBlock - 1) / kCompactBlock;
+    blockKept.assign(numBlocks + 1, 0);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            size_t begin = b * kCompactBlock;
+            size_t end = std::min(numFaces, begin + kCompactBlock);
+            int removed = 0;
+            for (size_t w = begin >> 6; w < (end + 63) >> 6; ++w) {
+                uint64_t word = mask[w];
+                if ((w + 1) * 64 > end) word &= (uint64_t(1) << (end & 63)) - 1;
+                removed += static_cast<int>(std::bitset<64>(word).count());
+            }
+            blockKept[b + 1] = static_cast<int>(end - begin) - removed;
+        }
+    });
+    for (size_t b = 0; b < numBlocks; ++b) {
+        blockKept[b + 1] += blockKept[b];
+    }
+    faceRemap.resize(numFaces);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            int next = blockKept[b];
+            for (size_t f = b * kCompactBlock; f < std::min(numFaces, (b + 1) * kCompactBlock); ++f) {
+                faceRemap[f] = isFaceRemoved(mask, f) ? -1 : next++;
+            }
+        }
+    });
+    return blockKept[numBlocks];
+}
+
+// Stable in-place compaction of an array with `width` entries per face.
+// value(oldSlot, newSlot) gives the entry written for each kept slot. Blocks
+// first compact to their own front in parallel (writes never pass reads),
+// then the runs are shifted down in order; destinations always precede
+// sources, so the memmove pass is safe and touches each kept entry once.
+template <typename T, typename Value>
+static void compactFaceArray(std::vector<T>& data, int width, const std::vector<int>& faceRemap,
+                      const std::vector<int>& blockKept, Value value) {
+    const size_t numFaces = faceRemap.size();
+    const size_t numBlocks = blockKept.size() - 1;
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            size_t out = b * kCompactBlock * width;
+            for (size_t f = b * kCompactBlock; f < std::min(numFaces, (b + 1) * kCompactBlock); ++f) {
+                int nf = faceRemap[f];
+                if (nf < 0) continue;
+                for (int i = 0; i < width; ++i) {
+                    data[out++] = value(f * width + i, static_cast<size_t>(nf) * width + i);
+                }
+            }
+        }
+    });
+    for (size_t b = 0; b < numBlocks; ++b) {
+        size_t from = b * kCompactBlock * width;
+        size_t to = static_cast<size_t>(blockKept[b]) * width;
+        size_t count = static_cast<size_t>(blockKept[b + 1] - blockKept[b]) * width;
+        if (from != to && count > 0) {
+            std::memmove(data.data() + to, data.data() + from, count * sizeof(T));
+        }
+    }
+    data.resize(static_cast<size_t>(blockKept[numBlocks]) * width);
+}
+
+template <typename T>
+static void compactFaceArray(std::vector<T>& data, int width, const std::vector<int>& faceRemap,
+                      const std::vector<int>& blockKept) {
+    compactFaceArray(data, width, faceRemap, blockKept, [&data](size_t oldSlot, size_t) { return data[oldSlot]; });
+}
+
+void removeFaces(Mesh& mesh, const std::vector<int>& faces, std::vector<int>* faceRemapOut) {
+    TRACE_FUNCTION();
+    FaceRemovalScratch& scratch = faceRemovalScratch();
+    std::vector<int>& faceRemap = faceRemapOut ? *faceRemapOut : scratch.faceRemap;
+    const int numFaces = static_cast<int>(mesh.indices.size() / 3);
+    EdgeTable& edges = mesh.edgeToFaces;
+    HalfEdges& halfEdges = mesh.halfEdges;
+
+    // `faces` may be one of the mesh's boundary lists; it is only read here,
+    // before collectBoundaryFaces rebuilds them
+    scratch.removedMask.assign((static_cast<size_t>(numFaces) + 63) / 64, 0);
+    scratch.edgeTouched.assign(edges.size(), 0);
+    for (int f : faces) {
+        if (f < 0 || f >= numFaces) continue;
+        scratch.removedMask[f >> 6] |= uint64_t(1) << (f & 63);
+        // Only edges of removed faces change their face lists
+        for (int i = 0; i < 3; ++i) scratch.edgeTouched[edges.cornerEdges[f * 3 + i]] = 1;
+    }
+    const int kept = buildFaceRemap(scratch.removedMask, numFaces, scratch.blockKept, faceRemap);
+    if (kept == numFaces) {
+        return;
+    }
+    TRACE_COUNT(trace::Counter::FacesProcessed, numFaces);
+    auto remapCorner = [&faceRemap](int c) { return faceRemap[c / 3] * 3 + c % 3; };
+
+    // Compact the edge table in place, dropping edges with no faces left.
+    // Writes never overtake reads: offsets[e + 1] is read before slot e + 1 can be written.
+    scratch.edgeRemap.resize(edges.size());
+    int numEdges = 0;
+    int writeFace = 0;
+    int readBegin = 0;
+    for (size_t e = 0; e < edges.size(); ++e) {
+        int readEnd = edges.offsets[e + 1];
+        int start = writeFace;
+        for (int k = readBegin; k < readEnd; ++k) {
+            int nf = faceRemap[edges.faces[k]];
+            if (nf >= 0) edges.faces[writeFace++] = nf;
+        }
+        readBegin = readEnd;
+        if (writeFace == start) {
+            scratch.edgeRemap[e] = -1;
+            continue;
+        }
+        scratch.edgeRemap[e] = numEdges;
+        edges.keys[numEdges] = edges.keys[e];
+        edges.offsets[numEdges + 1] = writeFace;
+        numEdges++;
+    }
+    scratch.newEdgeTouched.assign(numEdges, 0);
+    for (size_t e = 0; e < scratch.edgeRemap.size(); ++e) {
+        if (scratch.edgeTouched[e] && scratch.edgeRemap[e] >= 0) scratch.newEdgeTouched[scratch.edgeRemap[e]] = 1;
+    }
+    edges.keys.resize(numEdges);
+    edges.offsets.resize(numEdges + 1);
+    edges.faces.resize(writeFace);
+
+    // Per-corner arrays. Twins only need recomputing on touched edges (against
+    // the finished corner edges); elsewhere they are renumbered.
+    const std::vector<int>& blockKept = scratch.blockKept;
+    compactFaceArray(edges.cornerEdges, 3, faceRemap, blockKept, [&](size_t oldSlot, size_t) {
+        return scratch.edgeRemap[edges.cornerEdges[oldSlot]];
+    });
+    compactFaceArray(halfEdges.twins, 3, faceRemap, blockKept, [&](size_t oldSlot, size_t newSlot) {
+        int corner = static_cast<int>(newSlot);
+        if (scratch.newEdgeTouched[edges.cornerEdges[corner]]) {
+            return findTwin(edges, corner);
+        }
+        int twin = halfEdges.twins[oldSlot];
+        return twin >= 0 ? remapCorner(twin) : twin;
+    });
+    compactFaceArray(mesh.indices, 3, faceRemap, blockKept);
+    compactFaceArray(mesh.faceNormals, 1, faceRemap, blockKept);
+    compactFaceArray(mesh.boundaryClass, 1, faceRemap, blockKept);
+    if (mesh.faceOrigin.size() == static_cast<size_t>(numFaces)) {
+        compactFaceArray(mesh.faceOrigin, 1, faceRemap, blockKept);
+    }
+
+    // Vertex corners keep their order minus the removed corners (in place, as above)
+    int writeCorner = 0;
+    readBegin = 0;
+    for (size_t v = 0; v + 1 < halfEdges.vertexOffsets.size(); ++v) {
+        int readEnd = halfEdges.vertexOffsets[v + 1];
+        for (int k = readBegin; k < readEnd; ++k) {
+            int c = halfEdges.vertexCorners[k];
+            if (faceRemap[c / 3] >= 0) halfEdges.vertexCorners[writeCorner++] = remapCorner(c);
+        }
+        readBegin = readEnd;
+        halfEdges.vertexOffsets[v + 1] = writeCorner;
+    }
+    halfEdges.vertexCorners.resize(writeCorner);
+
+    // Reclassify only the surviving neighbors of removed faces
+    for (int e = 0; e < numEdges; ++e) {
+        if (!scratch.newEdgeTouched[e]) continue;
+        for (const int* f = edges.facesBegin(e); f != edges.facesEnd(e); ++f) {
+            mesh.boundaryClass[*f] = countBoundaryEdges(edges, *f);
+        }
+    }
+
+    std::cout << "Removed " << numFaces - kept << " faces\n";
+
+    collectBoundaryFaces(mesh);
+    analyzeMesh(mesh.edgeToFaces);
+    printBoundaryFaces(mesh);
+}
+
 void removeBoundaryFaces(Mesh& mesh, int boundarySelection) {
+    TRACE_FUNCTION();
     // Get the appropriate boundary faces based on selection
-    const std::vector<int>* facesToRemoveVec = nullptr;
+    const std::vector<int>* facesToRemove = nullptr;
     if (boundarySelection == 0) {
-        facesToRemoveVec = &mesh.boundaryFaces_1;
+        facesToRemove = &mesh.boundaryFaces_1;
     } else if (boundarySelection == 1) {
-        facesToRemoveVec = &mesh.boundaryFaces_2;
+        facesToRemove = &mesh.boundaryFaces_2;
     } else {
-        facesToRemoveVec = &mesh.boundaryFaces_3;
+        facesToRemove = &mesh.boundaryFaces_3;
     }
     
-    if (facesToRemoveVec->empty()) {
+    if (facesToRemove->empty()) {
         return;
     }
     
-    // Build set for fast lookup
-    std::unordered_set<int> facesToRemove(facesToRemoveVec->begin(), facesToRemoveVec->end());
-    
-    // Filter faces - skip those in the removal set
-    std::vector<int> newIndices;
-    std::vector<glm::vec3> newNormals;
-    
-    int numTriangles = mesh.indices.size() / 3;
-    for (int faceIdx = 0; faceIdx < numTriangles; faceIdx++) {
-        if (facesToRemove.count(faceIdx) == 0) {
-            // Keep this face
-            newIndices.push_back(mesh.indices[faceIdx * 3 + 0]);
-            newIndices.push_back(mesh.indices[faceIdx * 3 + 1]);
-            newIndices.push_back(mesh.indices[faceIdx * 3 + 2]);
-            newNormals.push_back(mesh.faceNormals[faceIdx]);
+    removeFaces(mesh, *facesToRemove);
+}
+
+std::vector<PeelIteration> peelBoundaryFaces(Mesh& mesh, int boundarySelection, int maxIterations,
+                                            const ProgressCallback& progress) {
+    TRACE_FUNCTION();
+    std::vector<PeelIteration> iterations;
+    const EdgeTable& edges = mesh.edgeToFaces;
+    const int numFaces = static_cast<int>(mesh.indices.size() / 3);
+    const uint8_t target = static_cast<uint8_t>(boundarySelection + 1);
+
+    // Live face count per edge and boundary class per face, updated as faces go
+    std::vector<int> liveCount(edges.size());
+    for (size_t e = 0; e < edges.size(); ++e) {
+        liveCount[e] = edges.faceCount(static_cast<int>(e));
+    }
+    std::vector<uint8_t> boundaryClass = mesh.boundaryClass;
+    std::vector<char> removed(numFaces, 0);
+    std::vector<int> queuedIn(numFaces, -1);   // Round a face was queued for
+
+    const std::vector<int>& selected = boundarySelection == 0 ? mesh.boundaryFaces_1
+                                     : boundarySelection == 1 ? mesh.boundaryFaces_2
+                                     : mesh.boundaryFaces_3;
+    std::vector<int> frontier = selected;
+    std::vector<int> next;
+    std::vector<int> allRemoved;
+    int remaining = numFaces;
+
+    while (!frontier.empty() && (maxIterations <= 0 || static_cast<int>(iterations.size()) < maxIterations)) {
+        // A round removes the whole frontier at once, like one Remove click
+        for (int f : frontier) {
+            removed[f] = 1;
+            for (int i = 0; i < 3; ++i) liveCount[edges.cornerEdges[f * 3 + i]]--;
+        }
+        allRemoved.insert(allRemoved.end(), frontier.begin(), frontier.end());
+        remaining -= static_cast<int>(frontier.size());
+
+        // Only neighbors across the removed faces' edges can change class
+        const int round = static_cast<int>(iterations.size());
+        next.clear();
+        for (int f : frontier) {
+            for (int i = 0; i < 3; ++i) {
+                int edge = edges.cornerEdges[f * 3 + i];
+                for (const int* g = edges.facesBegin(edge); g != edges.facesEnd(edge); ++g) {
+                    if (removed[*g] || queuedIn[*g] == round) continue;
+                    uint8_t count = 0;
+                    for (int j = 0; j < 3; ++j) count += (liveCount[edges.cornerEdges[*g * 3 + j]] == 1);
+                    boundaryClass[*g] = count;
+                    if (count == target) {
+                        queuedIn[*g] = round;
+                        next.push_back(*g);
+                    }
+                }
+            }
+        }
+
+        PeelIteration stats;
+        stats.removedFaces = static_cast<int>(frontier.size());
+        stats.remainingFaces = remaining;
+        iterations.push_back(stats);
+        std::cout << "Peel round " << iterations.size() << ": removed " << stats.removedFaces
+         << " faces, " << stats.remainingFaces << " left\n";
+        frontier.swap(next);
+
+        // Without a round limit the share of faces gone is the best estimate
+        const float done = maxIterations > 0 ? static_cast<float>(iterations.size()) / maxIterations
+                                             : static_cast<float>(numFaces - remaining) / numFaces;
+        if (!reportProgress(progress, done)) {
+            return std::vector<PeelIteration>();
         }
     }
-    
-    // Removed (show selected boundary)
-    std::cout << "Removed " << facesToRemove.size() << " boundary faces\n";
-    
-    mesh.indices = std::move(newIndices);
-    mesh.faceNormals = std::move(newNormals);
-    
-    // Rebuild adjacency and boundary info after modification
-    mesh.boundaryFaces_1.clear();
-    mesh.boundaryFaces_2.clear();
-    mesh.boundaryFaces_3.clear();
-    mesh.edgeToFaces = buildEdgeFaceAdjacency(mesh);
-    analyzeMesh(mesh.edgeToFaces);
-    findBoundaryFaces(mesh);
+
+    if (!allRemoved.empty()) {
+        removeFaces(mesh, allRemoved);
+    }
+    return iterations;
 }
 
-void prepareMeshForGL(Mesh& mesh, int highlightSelection)
-{
-    // Build set of faces to highlight
-    std::unordered_set<int> highlightFaces;
-    if (highlightSelection == 0) {
-        highlightFaces.insert(mesh.boundaryFaces_1.begin(), mesh.boundaryFaces_1.end());
-    } else if (highlightSelection == 1) {
-        highlightFaces.insert(mesh.boundaryFaces_2.begin(), mesh.boundaryFaces_2.end());
-    } else if (highlightSelection == 2) {
-        highlightFaces.insert(mesh.boundaryFaces_3.begin(), mesh.boundaryFaces_3.end());
+int removeUnusedVertices(Mesh& mesh, bool reorderByFirstUse) {
+    TRACE_FUNCTION();
+    HalfEdges& halfEdges = mesh.halfEdges;
+    const int numVertices = static_cast<int>(mesh.vertices.size());
+    const size_t grain = 1 << 14;
+    const size_t capacityBytes = mesh.vertices.capacity() * sizeof(glm::vec3) +
+                                 halfEdges.vertexOffsets.capacity() * sizeof(int);
+
+    // A vertex is used iff it has outgoing corners; vertexCorners lists them
+    // in increasing order, so the first entry is the vertex's first use
+    auto isUsed = [&halfEdges](int v) { return halfEdges.vertexOffsets[v + 1] > halfEdges.vertexOffsets[v]; };
+    std::vector<int> newIndex(numVertices, -1);
+    int numUsed = 0;
+    if (reorderByFirstUse) {
+        std::vector<uint64_t> firstCorner;
+        std::vector<int> order;
+        for (int v = 0; v < numVertices; ++v) {
+            if (!isUsed(v)) continue;
+            firstCorner.push_back(static_cast<uint64_t>(halfEdges.vertexCorners[halfEdges.vertexOffsets[v]]));
+            order.push_back(v);
+        }
+        int cornerBits = 1;
+        while (cornerBits < 63 && (uint64_t(1) << cornerBits) < mesh.indices.size()) cornerBits++;
+        parallelRadixSort(firstCorner, order, cornerBits);
+        numUsed = static_cast<int>(order.size());
+        for (int i = 0; i < numUsed; ++i) newIndex[order[i]] = i;
+    } else {
+        for (int v = 0; v < numVertices; ++v) {
+            if (isUsed(v)) newIndex[v] = numUsed++;
+        }
     }
-    
-    // Build interleaved vertex data: position(3) + normal(3) + isBoundary(1)
-    mesh.glVertices.clear();
-    
-    size_t numTriangles = mesh.indices.size() / 3;
-    mesh.glVertices.reserve(numTriangles * 3 * 7);
-    
-    for (size_t t = 0; t < numTriangles; ++t) {
-        glm::vec3 normal = mesh.faceNormals[t];
-        float isBoundary = highlightFaces.count(t) ? 1.0f : 0.0f;
-        
-        for (int v = 0; v < 3; ++v) {
-            int idx = mesh.indices[t * 3 + v];
-            glm::vec3 pos = mesh.vertices[idx];
-            
-            mesh.glVertices.push_back(pos.x);
-            mesh.glVertices.push_back(pos.y);
-            mesh.glVertices.push_back(pos.z);
-            mesh.glVertices.push_back(normal.x);
-            mesh.glVertices.push_back(normal.y);
-            mesh.glVertices.push_back(normal.z);
-            mesh.glVertices.push_back(isBoundary);
+    const int removed = numVertices - numUsed;
+    if (removed == 0 && !reorderByFirstUse) {
+        return 0;
+    }
+
+    // Move positions and per-vertex corner ranges to their new slots. Without
+    // reordering new <= old, so an in-order pass can work in place.
+    if (reorderByFirstUse) {
+        std::vector<glm::vec3> vertices(numUsed);
+        parallelFor(numVertices, grain, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v) {
+                if (newIndex[v] < 0) continue;
+                vertices[newIndex[v]] = mesh.vertices[v];
+            }
+        });
+        mesh.vertices.swap(vertices);
+    } else {
+        // Unused vertices have empty corner ranges, so dropping their offsets keeps the CSR valid
+        for (int v = 0; v < numVertices; ++v) {
+            if (newIndex[v] < 0) continue;
+            mesh.vertices[newIndex[v]] = mesh.vertices[v];
+            halfEdges.vertexOffsets[newIndex[v] + 1] = halfEdges.vertexOffsets[v + 1];
         }
+        mesh.vertices.resize(numUsed);
+        halfEdges.vertexOffsets.resize(numUsed + 1);
     }
-    
-    mesh.vertexCount = static_cast<int>(mesh.glVertices.size() / 7);
-    
-    // Upload to GPU
-    if (mesh.VAO == 0) glGenVertexArrays(1, &mesh.VAO);
-    if (mesh.VBO == 0) glGenBuffers(1, &mesh.VBO);
-    
-    glBindVertexArray(mesh.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-    glBufferData(GL_ARRAY_BUFFER,
-                 mesh.glVertices.size() * sizeof(float),
-                 mesh.glVertices.data(),
-                 GL_STATIC_DRAW);
-    
-    // Position attribute (location 0)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    // Normal attribute (location 1)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    // IsBoundary attribute (location 2)
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    glBindVertexArray(0);
+
+    // Rewrite every index in one parallel pass
+    parallelFor(mesh.indices.size(), grain, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            mesh.indices[c] = newIndex[mesh.indices[c]];
+        }
+    });
+
+    if (reorderByFirstUse) {
+        // Edge keys and ids follow vertex order, so rebuild the adjacency
+        mesh.edgeToFaces = buildEdgeFaceAdjacency(mesh);
+        mesh.halfEdges = buildHalfEdges(mesh);
+    } else {
+        // Relative vertex order is unchanged, so the sorted edge keys stay sorted
+        EdgeTable& edges = mesh.edgeToFaces;
+        parallelFor(edges.keys.size(), grain, [&](size_t begin, size_t end) {
+            for (size_t e = begin; e < end; ++e) {
+                edges.keys[e] = makeEdgeKey(newIndex[edgeKeyFirst(edges.keys[e])], newIndex[edgeKeySecond(edges.keys[e])]);
+            }
+        });
+    }
+
+    mesh.vertices.shrink_to_fit();
+    halfEdges.vertexOffsets.shrink_to_fit();
+    const size_t reclaimed = capacityBytes - (mesh.vertices.capacity() * sizeof(glm::vec3) +
+                                              mesh.halfEdges.vertexOffsets.capacity() * sizeof(int));
+    std::cout << "Removed " << removed << " unused vertices (" << reclaimed / 1024.0 << " KB reclaimed"
+              << (reorderByFirstUse ? ", reordered by first use" : "") << ")\n";
+    return removed;
 }
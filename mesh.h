@@ -1,15 +1,60 @@
 #ifndef MESH_H
 #define MESH_H
 
-#include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <string>
-#include <map>
-#include <utility>
 
-// Edge type: ordered pair of vertex indices (smaller index first)
-using Edge = std::pair<int, int>;
+// Progress of a long-running edit: called with the fraction done (0..1)
+// between its passes or iterations. Returning false cancels the edit, which
+// then returns early and leaves a valid mesh, unchanged or partly edited.
+using ProgressCallback = std::function<bool(float)>;
+
+// True if the edit should go on (no callback, or the callback did not cancel)
+inline bool reportProgress(const ProgressCallback& progress, float fraction)
+{
+    return !progress || progress(fraction);
+}
+
+// Edge key: both vertex indices packed into 64 bits (smaller index in the high half)
+using EdgeKey = uint64_t;
+
+// Edge - adjacent faces table in CSR layout
+struct EdgeTable {
+    std::vector<EdgeKey> keys;        // Sorted unique edge keys
+    std::vector<int> offsets;         // keys.size() + 1 entries
+    std::vector<int> faces;           // Faces of edge e: faces[offsets[e] .. offsets[e + 1])
+    std::vector<int> cornerEdges;     // Edge id of triangle edge (indices[3f + i], indices[3f + (i + 1) % 3])
+
+    size_t size() const { return keys.size(); }
+    int faceCount(int edge) const { return offsets[edge + 1] - offsets[edge]; }
+    const int* facesBegin(int edge) const { return faces.data() + offsets[edge]; }
+    const int* facesEnd(int edge) const { return faces.data() + offsets[edge + 1]; }
+
+    // Edge id of (v0, v1), or -1 if the edge is not in the mesh. O(log E)
+    int find(int v0, int v1) const;
+};
+
+// Half-edge connectivity over triangle corners. Half-edge h = 3 * face + i
+// runs from indices[h] to indices[3 * face + (i + 1) % 3].
+constexpr int kBoundaryHalfEdge = -1;       // Edge with one face
+constexpr int kNonManifoldHalfEdge = -2;    // Edge with 3+ faces
+
+struct HalfEdges {
+    std::vector<int> twins;           // Other half-edge of the same edge, or kBoundaryHalfEdge / kNonManifoldHalfEdge
+    std::vector<int> vertexOffsets;   // vertices.size() + 1 entries
+    std::vector<int> vertexCorners;   // Half-edges leaving v: vertexCorners[vertexOffsets[v] .. vertexOffsets[v + 1])
+
+    int twin(int h) const { return twins[h]; }
+    const int* cornersBegin(int v) const { return vertexCorners.data() + vertexOffsets[v]; }
+    const int* cornersEnd(int v) const { return vertexCorners.data() + vertexOffsets[v + 1]; }
+};
+
+inline int halfEdgeFace(int h) { return h / 3; }
+inline int nextHalfEdge(int h) { return h % 3 == 2 ? h - 2 : h + 1; }
+inline int prevHalfEdge(int h) { return h % 3 == 0 ? h + 2 : h - 1; }
 
 // Indexed mesh representation
 struct Mesh {
@@ -17,39 +62,109 @@ struct Mesh {
     std::vector<glm::vec3> vertices;      // Unique vertex positions
     std::vector<int> indices;             // 3 indices per triangle
     std::vector<glm::vec3> faceNormals;   // One normal per triangle
-    std::map<Edge, std::vector<int>> edgeToFaces; // Edge - adjacent faces mapping
+    EdgeTable edgeToFaces;                // Edge - adjacent faces mapping
+    HalfEdges halfEdges;                  // Twins and vertex - corner mapping
     
+    std::vector<uint8_t> boundaryClass;   // Number of boundary edges of each face (0-3)
     std::vector<int> boundaryFaces_1;
     std::vector<int> boundaryFaces_2;
     std::vector<int> boundaryFaces_3;
 
-    // OpenGL
-    std::vector<float> glVertices;        // Interleaved data for GPU
-    unsigned int VAO = 0, VBO = 0;
-    int vertexCount = 0;
+    // Optional caller-defined id per face (empty = not tracked). Face removal
+    // keeps it in step with the faces; MeshHistory stores base face ids here.
+    std::vector<int> faceOrigin;
 };
 
 // Create an edge key with consistent ordering
-inline Edge makeEdge(int v0, int v1) {
-    return v0 < v1 ? Edge{v0, v1} : Edge{v1, v0};
+inline EdgeKey makeEdgeKey(int v0, int v1) {
+    uint32_t a = static_cast<uint32_t>(v0 < v1 ? v0 : v1);
+    uint32_t b = static_cast<uint32_t>(v0 < v1 ? v1 : v0);
+    return (static_cast<EdgeKey>(a) << 32) | b;
 }
 
+inline int edgeKeyFirst(EdgeKey key) { return static_cast<int>(key >> 32); }
+inline int edgeKeySecond(EdgeKey key) { return static_cast<int>(key & 0xFFFFFFFFu); }
+
+// OBJ parsing strategy
+enum class OBJLoadMode {
+    Stream,     // std::getline + std::istringstream per line
+    Mapped,     // mmap the file and scan records in place
+    Parallel    // Mapped, split into chunks parsed and welded on the thread pool
+};
+
+// Geometry core: no OpenGL here, see render.h for GPU upload.
+
 // Load OBJ file into indexed mesh.
-Mesh loadOBJ(const std::string& path);
+// All modes produce the same mesh; parse throughput is printed for comparison.
+Mesh loadOBJ(const std::string& path, OBJLoadMode mode = OBJLoadMode::Parallel);
+
+// Build edge - adjacent faces table by sorting (edge key, corner) pairs
+EdgeTable buildEdgeFaceAdjacency(const Mesh& mesh);
+
+// Build half-edge twins and vertex corners from mesh.edgeToFaces (no sorting)
+HalfEdges buildHalfEdges(const Mesh& mesh);
+
+// Face across edge i (0..2) of face, or -1 if the edge is boundary or non-manifold. O(1)
+inline int faceNeighbor(const Mesh& mesh, int face, int i) {
+    int twin = mesh.halfEdges.twins[face * 3 + i];
+    return twin >= 0 ? halfEdgeFace(twin) : -1;
+}
+
+// Vertices sharing an edge with vertex (unique, in corner order)
+void vertexOneRing(const Mesh& mesh, int vertex, std::vector<int>& ring);
+
+// Closed or open chains of boundary half-edges, each in walking order.
+// A chain stops early at non-manifold edges or inconsistently oriented faces.
+std::vector<std::vector<int>> findBoundaryLoops(const Mesh& mesh);
 
-// Build edge - adjacent faces map 
-std::map<Edge, std::vector<int>> buildEdgeFaceAdjacency(const Mesh& mesh);
+// Edge counts by number of adjacent faces
+struct EdgeStats {
+    int boundaryEdges = 0;          // 1 face
+    int manifoldEdges = 0;          // 2 faces
+    int nonManifoldEdges_3 = 0;     // 3 faces
+    int nonManifoldEdges_4 = 0;     // 4 faces
+    int nonManifoldEdges = 0;       // 5+ faces
 
-// Count mesh edge
-void analyzeMesh(const std::map<Edge, std::vector<int>>& mesh);
+    int nonManifoldTotal() const { return nonManifoldEdges_3 + nonManifoldEdges_4 + nonManifoldEdges; }
+};
+
+// Count mesh edges by number of adjacent faces; prints and returns the counts
+EdgeStats analyzeMesh(const EdgeTable& edgeToFaces);
 
 void findBoundaryFaces(Mesh& mesh);
 
+// Remove faces and update adjacency, half-edges and boundary classification in place.
+// Face arrays are compacted stably in parallel from a removal bitmask, reusing
+// per-thread scratch buffers, so repeated removals do not allocate.
+// Only faces next to removed ones are reclassified; everything else is renumbered.
+// faceRemap (optional) receives old -> new face ids (-1 = removed) for callers
+// that keep their own per-face data.
+void removeFaces(Mesh& mesh, const std::vector<int>& faces, std::vector<int>* faceRemap = nullptr);
+
 // Remove boundary faces from mesh (selection: 0 = 1 edge, 1 = 2 edges, 2 = 3 edges)
 void removeBoundaryFaces(Mesh& mesh, int boundarySelection);
 
-// Build OpenGL VBO from mesh and upload to GPU.
-// highlightSelection: -1 = no highlight, 0/1/2 = highlight 1/2/3-edge faces
-void prepareMeshForGL(Mesh& mesh, int highlightSelection = -1);
+// Statistics of one peelBoundaryFaces round
+struct PeelIteration {
+    int removedFaces = 0;      // Faces removed in this round
+    int remainingFaces = 0;    // Faces left after this round
+};
+
+// Repeat removeBoundaryFaces(boundarySelection) until no face has the selected number
+// of boundary edges, or for at most maxIterations rounds (0 = until stable).
+// Rounds follow a worklist of newly exposed neighbors; the mesh is compacted once at the end.
+// progress is called after every round; if it cancels, the mesh is left unchanged and
+// no rounds are returned.
+std::vector<PeelIteration> peelBoundaryFaces(Mesh& mesh, int boundarySelection, int maxIterations = 0,
+                                             const ProgressCallback& progress = ProgressCallback());
+
+// Drop vertices no face references and renumber indices, edge keys and the
+// vertex-corner lists. reorderByFirstUse also renumbers the survivors in order
+// of first use in indices (better locality for rendering and export) and
+// rebuilds the adjacency. Prints the memory reclaimed; returns the number removed.
+int removeUnusedVertices(Mesh& mesh, bool reorderByFirstUse = false);
+
+// Write vertices and triangles as an OBJ file
+bool saveOBJ(const Mesh& mesh, const std::string& path);
 
 #endif
@@ -0,0 +1,283 @@
+#include "mesh_cache.h"
+#include "mapped_file.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+
+const char kMagic[4] = {'N', 'M', 'C', '1'};
+const uint32_t kVersion = 3;
+const uint32_t kByteOrder = 0x01020304;
+const uint64_t kAlignment = 64;
+
+enum SectionId : uint32_t {
+    kVertices = 1,
+    kIndices,
+    kFaceNormals,
+    kEdgeKeys,          // EdgeTable::keys
+    kEdgeOffsets,       // EdgeTable::offsets
+    kEdgeFaces,         // EdgeTable::faces
+    kCornerEdges,       // EdgeTable::cornerEdges
+    kBoundaryFaces1,
+    kBoundaryFaces2,
+    kBoundaryFaces3,
+    kSectionCount = kBoundaryFaces3
+};
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t sectionCount;
+    uint64_t sourceSize;
+    int64_t sourceModified;     // OBJ modification time, ns since the epoch
+};
+
+struct CacheSection {
+    uint32_t id;
+    uint32_t elementSize;
+    uint64_t offset;        // from start of file, kAlignment aligned
+    uint64_t count;         // number of elements
+};
+
+struct SectionData {
+    const void* data;
+    uint32_t elementSize;
+    uint64_t count;
+};
+
+uint64_t alignUp(uint64_t value) {
+    return (value + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Copy a validated section into a vector (Mesh owns and edits its arrays, so
+// they cannot alias the mapping; each copy is one sequential memcpy)
+template <typename T>
+bool readSection(const MappedFile& file, const CacheSection* sections, SectionId id, std::vector<T>& out) {
+    const CacheSection& section = sections[id - 1];
+    if (section.id != id || section.elementSize != sizeof(T) ||
+        section.offset > file.size() ||
+        section.count > (file.size() - section.offset) / sizeof(T)) {
+        return false;
+    }
+    out.resize(section.count);
+    if (section.count > 0) {
+        std::memcpy(out.data(), file.data() + section.offset, section.count * sizeof(T));
+    }
+    return true;
+}
+
+bool statFile(const std::string& path, struct stat& st) {
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+// Modification time in nanoseconds (whole seconds where stat has no sub-second field)
+int64_t modifiedNs(const struct stat& st) {
+#if defined(__APPLE__)
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtime) * 1000000000;
+#endif
+}
+
+} // namespace
+
+std::string meshCachePath(const std::string& objPath)
+{
+    size_t dot = objPath.find_last_of('.');
+    size_t slash = objPath.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return objPath + ".nmc";
+    }
+    return objPath.substr(0, dot) + ".nmc";
+}
+
+bool readMeshCache(const std::string& cachePath, Mesh& mesh, MeshCacheSource* source)
+{
+    TRACE_FUNCTION();
+    MappedFile file(cachePath);
+    if (!file.isOpen() || file.size() < sizeof(CacheHeader) + kSectionCount * sizeof(CacheSection)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion ||
+        header.byteOrder != kByteOrder ||
+        header.sectionCount != kSectionCount) {
+        return false;
+    }
+    CacheSection sections[kSectionCount];
+    std::memcpy(sections, file.data() + sizeof(CacheHeader), sizeof(sections));
+
+    Mesh loaded;
+    EdgeTable& edges = loaded.edgeToFaces;
+    bool ok = readSection(file, sections, kVertices, loaded.vertices) &&
+              readSection(file, sections, kIndices, loaded.indices) &&
+              readSection(file, sections, kFaceNormals, loaded.faceNormals) &&
+              readSection(file, sections, kEdgeKeys, edges.keys) &&
+              readSection(file, sections, kEdgeOffsets, edges.offsets) &&
+              readSection(file, sections, kEdgeFaces, edges.faces) &&
+              readSection(file, sections, kCornerEdges, edges.cornerEdges) &&
+              readSection(file, sections, kBoundaryFaces1, loaded.boundaryFaces_1) &&
+              readSection(file, sections, kBoundaryFaces2, loaded.boundaryFaces_2) &&
+              readSection(file, sections, kBoundaryFaces3, loaded.boundaryFaces_3);
+    if (!ok || edges.offsets.size() != edges.keys.size() + 1 ||
+        edges.offsets.front() != 0 ||
+        edges.offsets.back() != static_cast<int>(edges.faces.size()) ||
+        edges.cornerEdges.size() != loaded.indices.size() ||
+        loaded.faceNormals.size() * 3 != loaded.indices.size()) {
+        return false;
+    }
+    for (int index : loaded.indices) {
+        if (index < 0 || index >= static_cast<int>(loaded.vertices.size())) return false;
+    }
+    for (int edge : edges.cornerEdges) {
+        if (edge < 0 || edge >= static_cast<int>(edges.keys.size())) return false;
+    }
+    // Edge lookups binary search the keys, walk the face ranges and index
+    // per-vertex arrays with the key's endpoints, so a corrupt table must not
+    // get past here
+    const int numVertices = static_cast<int>(loaded.vertices.size());
+    for (size_t e = 0; e < edges.keys.size(); ++e) {
+        if (edges.offsets[e] > edges.offsets[e + 1]) return false;
+        if (e > 0 && edges.keys[e - 1] >= edges.keys[e]) return false;
+        const int first = edgeKeyFirst(edges.keys[e]);
+        const int second = edgeKeySecond(edges.keys[e]);
+        if (first < 0 || first >= second || second >= numVertices) return false;
+    }
+    const int numFaces = static_cast<int>(loaded.faceNormals.size());
+    for (int face : edges.faces) {
+        if (face < 0 || face >= numFaces) return false;
+    }
+
+    // Per-face boundary class from the three boundary lists
+    loaded.boundaryClass.assign(loaded.indices.size() / 3, 0);
+    const std::vector<int>* boundaryLists[3] = {&loaded.boundaryFaces_1, &loaded.boundaryFaces_2, &loaded.boundaryFaces_3};
+    for (int k = 0; k < 3; ++k) {
+        for (int face : *boundaryLists[k]) {
+            if (face < 0 || face >= static_cast<int>(loaded.boundaryClass.size())) return false;
+            loaded.boundaryClass[face] = static_cast<uint8_t>(k + 1);
+        }
+    }
+
+    // Half-edges are a linear pass over the stored edge table
+    loaded.halfEdges = buildHalfEdges(loaded);
+
+    mesh = std::move(loaded);
+    if (source) {
+        source->size = header.sourceSize;
+        source->modified = header.sourceModified;
+    }
+    return true;
+}
+
+bool writeMeshCache(const std::string& cachePath, const Mesh& mesh, const MeshCacheSource& source)
+{
+    TRACE_FUNCTION();
+    const EdgeTable& edges = mesh.edgeToFaces;
+    const SectionData data[kSectionCount] = {
+        {mesh.vertices.data(), sizeof(glm::vec3), mesh.vertices.size()},
+        {mesh.indices.data(), sizeof(int), mesh.indices.size()},
+        {mesh.faceNormals.data(), sizeof(glm::vec3), mesh.faceNormals.size()},
+        {edges.keys.data(), sizeof(EdgeKey), edges.keys.size()},
+        {edges.offsets.data(), sizeof(int), edges.offsets.size()},
+        {edges.faces.data(), sizeof(int), edges.faces.size()},
+        {edges.cornerEdges.data(), sizeof(int), edges.cornerEdges.size()},
+        {mesh.boundaryFaces_1.data(), sizeof(int), mesh.boundaryFaces_1.size()},
+        {mesh.boundaryFaces_2.data(), sizeof(int), mesh.boundaryFaces_2.size()},
+        {mesh.boundaryFaces_3.data(), sizeof(int), mesh.boundaryFaces_3.size()},
+    };
+
+    CacheHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.sectionCount = kSectionCount;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+
+    CacheSection sections[kSectionCount];
+    uint64_t offset = alignUp(sizeof(CacheHeader) + sizeof(sections));
+    for (uint32_t i = 0; i < kSectionCount; ++i) {
+        sections[i] = {i + 1, data[i].elementSize, offset, data[i].count};
+        offset = alignUp(offset + data[i].elementSize * data[i].count);
+    }
+
+    // Write to a temporary file and rename, so readers never see a partial cache
+    std::string tmpPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        const char padding[kAlignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(sections), sizeof(sections));
+        uint64_t written = sizeof(header) + sizeof(sections);
+        for (uint32_t i = 0; i < kSectionCount; ++i) {
+            out.write(padding, static_cast<std::streamsize>(sections[i].offset - written));
+            uint64_t bytes = data[i].elementSize * data[i].count;
+            out.write(static_cast<const char*>(data[i].data), static_cast<std::streamsize>(bytes));
+            written = sections[i].offset + bytes;
+        }
+        if (!out) {
+            out.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+Mesh loadMesh(const std::string& objPath, OBJLoadMode mode)
+{
+    TRACE_FUNCTION();
+    std::string cachePath = meshCachePath(objPath);
+
+    // The cache is only used for the exact OBJ it was written from: same size
+    // and same modification time, to the nanosecond where the platform has it
+    struct stat objStat;
+    bool haveObj = statFile(objPath, objStat);
+    MeshCacheSource objSource;
+    if (haveObj) {
+        objSource.size = static_cast<uint64_t>(objStat.st_size);
+        objSource.modified = modifiedNs(objStat);
+    }
+
+    if (haveObj) {
+        auto start = std::chrono::steady_clock::now();
+        Mesh mesh;
+        MeshCacheSource cacheSource;
+        if (readMeshCache(cachePath, mesh, &cacheSource) && cacheSource.size == objSource.size &&
+            cacheSource.modified == objSource.modified) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "loaded mesh cache " << cachePath << " in " << ms << " ms: "
+             << mesh.vertices.size() << " vertices, " << mesh.indices.size() / 3 << " triangles\n";
+            std::cout << "Boundary faces (1 edge): " << mesh.boundaryFaces_1.size() << "\n";
+            std::cout << "Boundary faces (2 edge): " << mesh.boundaryFaces_2.size() << "\n";
+            std::cout << "Boundary faces (3 edge): " << mesh.boundaryFaces_3.size() << "\n";
+            return mesh;
+        }
+    }
+
+    Mesh mesh = loadOBJ(objPath, mode);
+    if (haveObj && !mesh.indices.empty()) {
+        if (!writeMeshCache(cachePath, mesh, objSource)) {
+            std::cerr << "Failed to write mesh cache: " << cachePath << std::endl;
+        }
+    }
+    return mesh;
+}
@@ -0,0 +1,35 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "mesh.h"
+#include <cstdint>
+#include <string>
+
+// Binary mesh cache (.nmc): a versioned header, a section table and
+// 64-byte aligned arrays for vertices, indices, face normals, edge
+// adjacency and boundary faces, so a mapped file can be read without parsing.
+
+// Sidecar cache path for an OBJ file: "dir/shape1.obj" -> "dir/shape1.nmc"
+std::string meshCachePath(const std::string& objPath);
+
+// Identity of the OBJ a cache was written from
+struct MeshCacheSource {
+    uint64_t size = 0;          // File size in bytes
+    int64_t modified = 0;       // Modification time, ns since the epoch
+};
+
+// Read a cache file into mesh. Returns false if missing, corrupt or from another version;
+// indices, edge keys (and their endpoints), offsets and faces are range and order checked.
+// source (optional) receives the identity of the OBJ the cache was written from.
+bool readMeshCache(const std::string& cachePath, Mesh& mesh, MeshCacheSource* source = nullptr);
+
+// Write mesh (geometry, adjacency and boundary faces) to a cache file.
+// source identifies the OBJ the mesh was loaded from.
+bool writeMeshCache(const std::string& cachePath, const Mesh& mesh, const MeshCacheSource& source);
+
+// Load an OBJ through its cache: read the cache if it was written from an OBJ
+// with the same size and modification time (nanoseconds where available),
+// otherwise parse the OBJ with loadOBJ and (re)write the cache.
+Mesh loadMesh(const std::string& objPath, OBJLoadMode mode = OBJLoadMode::Parallel);
+
+#endif
@@ -0,0 +1,231 @@
+#include "normals.h"
+#include "parallel.h"
+#include "trace.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+// Fused multiply-adds would round differently from the scalar kernel
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NMD_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+enum class Kernel { Scalar, AVX2, AVX512 };
+
+// Same arithmetic as glm::normalize(glm::cross(v1 - v0, v2 - v0)), but a
+// zero vector when the cross product has no usable length
+void faceNormalsScalar(const PositionsSoA& p, const int* indices, size_t numFaces, glm::vec3* normals)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    for (size_t f = 0; f < numFaces; ++f) {
+        const int i0 = indices[f * 3 + 0], i1 = indices[f * 3 + 1], i2 = indices[f * 3 + 2];
+        const float e1x = p.x[i1] - p.x[i0], e1y = p.y[i1] - p.y[i0], e1z = p.z[i1] - p.z[i0];
+        const float e2x = p.x[i2] - p.x[i0], e2y = p.y[i2] - p.y[i0], e2z = p.z[i2] - p.z[i0];
+        const float cx = e1y * e2z - e2y * e1z;
+        const float cy = e1z * e2x - e2z * e1x;
+        const float cz = e1x * e2y - e2x * e1y;
+        const float d = (cx * cx + cy * cy) + cz * cz;
+        if (d > 0.0f && d < inf) {
+            const float inv = 1.0f / std::sqrt(d);
+            normals[f] = glm::vec3(cx * inv, cy * inv, cz * inv);
+        } else {
+            normals[f] = glm::vec3(0.0f);
+        }
+    }
+}
+
+#ifdef NMD_X86_KERNELS
+
+__attribute__((target("avx2")))
+void faceNormalsAVX2(const PositionsSoA& p, const int* indices, size_t numFaces, glm::vec3* normals)
+{
+    const __m256i corner = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    alignas(32) float nx[8], ny[8], nz[8];
+
+    size_t f = 0;
+    for (; f + 8 <= numFaces; f += 8) {
+        const int* face = indices + f * 3;
+        const __m256i i0 = _mm256_i32gather_epi32(face + 0, corner, 4);
+        const __m256i i1 = _mm256_i32gather_epi32(face + 1, corner, 4);
+        const __m256i i2 = _mm256_i32gather_epi32(face + 2, corner, 4);
+        const __m256 x0 = _mm256_i32gather_ps(p.x.data(), i0, 4);
+        const __m256 y0 = _mm256_i32gather_ps(p.y.data(), i0, 4);
+        const __m256 z0 = _mm256_i32gather_ps(p.z.data(), i0, 4);
+        const __m256 e1x = _mm256_sub_ps(_mm256_i32gather_ps(p.x.data(), i1, 4), x0);
+        const __m256 e1y = _mm256_sub_ps(_mm256_i32gather_ps(p.y.data(), i1, 4), y0);
+        const __m256 e1z = _mm256_sub_ps(_mm256_i32gather_ps(p.z.data(), i1, 4), z0);
+        const __m256 e2x = _mm256_sub_ps(_mm256_i32gather_ps(p.x.data(), i2, 4), x0);
+        const __m256 e2y = _mm256_sub_ps(_mm256_i32gather_ps(p.y.data(), i2, 4), y0);
+        const __m256 e2z = _mm256_sub_ps(_mm256_i32gather_ps(p.z.data(), i2, 4), z0);
+        const __m256 cx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e2y, e1z));
+        const __m256 cy = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e2z, e1x));
+        const __m256 cz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e2x, e1y));
+        const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)),
+                                       _mm256_mul_ps(cz, cz));
+        const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ), _mm256_cmp_ps(d, inf, _CMP_LT_OQ));
+        const __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(d));
+        _mm256_store_ps(nx, _mm256_and_ps(_mm256_mul_ps(cx, inv), valid));
+        _mm256_store_ps(ny, _mm256_and_ps(_mm256_mul_ps(cy, inv), valid));
+        _mm256_store_ps(nz, _mm256_and_ps(_mm256_mul_ps(cz, inv), valid));
+        for (int k = 0; k < 8; ++k) {
+            normals[f + k] = glm::vec3(nx[k], ny[k], nz[k]);
+        }
+    }
+    faceNormalsScalar(p, indices + f * 3, numFaces - f, normals + f);
+}
+
+// Gathers into a zero vector with every lane enabled. The unmasked gathers
+// start from an undefined vector, which GCC 12 reports as maybe-uninitialized.
+__attribute__((target("avx512f")))
+inline __m512i gatherInts16(const int* base, __m512i index)
+{
+    return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, index, base, 4);
+}
+
+__attribute__((target("avx512f")))
+inline __m512 gatherFloats16(const float* base, __m512i index)
+{
+    return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, index, base, 4);
+}
+
+__attribute__((target("avx512f")))
+void faceNormalsAVX512(const PositionsSoA& p, const int* indices, size_t numFaces, glm::vec3* normals)
+{
+    const __m512i corner = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 inf = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    alignas(64) float nx[16], ny[16], nz[16];
+
+    size_t f = 0;
+    for (; f + 16 <= numFaces; f += 16) {
+        const int* face = indices + f * 3;
+        const __m512i i0 = gatherInts16(face + 0, corner);
+        const __m512i i1 = gatherInts16(face + 1, corner);
+        const __m512i i2 = gatherInts16(face + 2, corner);
+        const __m512 x0 = gatherFloats16(p.x.data(), i0);
+        const __m512 y0 = gatherFloats16(p.y.data(), i0);
+        const __m512 z0 = gatherFloats16(p.z.data(), i0);
+        const __m512 e1x = _mm512_sub_ps(gatherFloats16(p.x.data(), i1), x0);
+        const __m512 e1y = _mm512_sub_ps(gatherFloats16(p.y.data(), i1), y0);
+        const __m512 e1z = _mm512_sub_ps(gatherFloats16(p.z.data(), i1), z0);
+        const __m512 e2x = _mm512_sub_ps(gatherFloats16(p.x.data(), i2), x0);
+        const __m512 e2y = _mm512_sub_ps(gatherFloats16(p.y.data(), i2), y0);
+        const __m512 e2z = _mm512_sub_ps(gatherFloats16(p.z.data(), i2), z0);
+        const __m512 cx = _mm512_sub_ps(_mm512_mul_ps(e1y, e2z), _mm512_mul_ps(e2y, e1z));
+        const __m512 cy = _mm512_sub_ps(_mm512_mul_ps(e1z, e2x), _mm512_mul_ps(e2z, e1x));
+        const __m512 cz = _mm512_sub_ps(_mm512_mul_ps(e1x, e2y), _mm512_mul_ps(e2x, e1y));
+        const __m512 d = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(cx, cx), _mm512_mul_ps(cy, cy)),
+                                       _mm512_mul_ps(cz, cz));
+        const __mmask16 valid = _mm512_cmp_ps_mask(d, zero, _CMP_GT_OQ) & _mm512_cmp_ps_mask(d, inf, _CMP_LT_OQ);
+        // Masked for the same reason as the gathers; invalid lanes are zeroed below
+        const __m512 inv = _mm512_div_ps(one, _mm512_maskz_sqrt_ps(valid, d));
+        _mm512_store_ps(nx, _mm512_maskz_mul_ps(valid, cx, inv));
+        _mm512_store_ps(ny, _mm512_maskz_mul_ps(valid, cy, inv));
+        _mm512_store_ps(nz, _mm512_maskz_mul_ps(valid, cz, inv));
+        for (int k = 0; k < 16; ++k) {
+            normals[f + k] = glm::vec3(nx[k], ny[k], nz[k]);
+        }
+    }
+    faceNormalsScalar(p, indices + f * 3, numFaces - f, normals + f);
+}
+
+#endif
+
+// Kernel from NMD_SIMD (avx512, avx2, scalar; default avx2), capped by what
+// the CPU supports. AVX-512 is opt-in: this kernel is bound by gathers and
+// gains only about a fifth over AVX2, while on many CPUs 512-bit code lowers
+// the clock of the whole core and slows the other stages running on it.
+Kernel selectKernel()
+{
+    Kernel wanted = Kernel::AVX2;
+    if (const char* env = std::getenv("NMD_SIMD")) {
+        if (std::strcmp(env, "scalar") == 0) wanted = Kernel::Scalar;
+        else if (std::strcmp(env, "avx512") == 0) wanted = Kernel::AVX512;
+    }
+    Kernel supported = Kernel::Scalar;
+#ifdef NMD_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        supported = Kernel::AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        supported = Kernel::AVX2;
+    }
+#endif
+    return wanted < supported ? wanted : supported;
+}
+
+Kernel activeKernel()
+{
+    static const Kernel kernel = selectKernel();
+    return kernel;
+}
+
+} // namespace
+
+PositionsSoA makePositionsSoA(const std::vector<glm::vec3>& vertices)
+{
+    PositionsSoA soa;
+    soa.x.resize(vertices.size());
+    soa.y.resize(vertices.size());
+    soa.z.resize(vertices.size());
+    parallelFor(vertices.size(), 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            soa.x[v] = vertices[v].x;
+            soa.y[v] = vertices[v].y;
+            soa.z[v] = vertices[v].z;
+        }
+    });
+    return soa;
+}
+
+void computeFaceNormals(const PositionsSoA& positions, const int* indices, size_t numFaces, glm::vec3* normals)
+{
+    switch (activeKernel()) {
+#ifdef NMD_X86_KERNELS
+    case Kernel::AVX512:
+        faceNormalsAVX512(positions, indices, numFaces, normals);
+        return;
+    case Kernel::AVX2:
+        faceNormalsAVX2(positions, indices, numFaces, normals);
+        return;
+#endif
+    default:
+        faceNormalsScalar(positions, indices, numFaces, normals);
+        return;
+    }
+}
+
+void computeFaceNormals(Mesh& mesh)
+{
+    TRACE_FUNCTION();
+    const size_t numFaces = mesh.indices.size() / 3;
+    mesh.faceNormals.resize(numFaces);
+    const PositionsSoA positions = makePositionsSoA(mesh.vertices);
+    parallelFor(numFaces, 1 << 14, [&](size_t begin, size_t end) {
+        computeFaceNormals(positions, mesh.indices.data() + begin * 3, end - begin, mesh.faceNormals.data() + begin);
+    });
+    TRACE_COUNT(trace::Counter::FacesProcessed, numFaces);
+}
+
+const char* faceNormalKernelName()
+{
+    switch (activeKernel()) {
+    case Kernel::AVX512: return "avx512";
+    case Kernel::AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef NORMALS_H
+#define NORMALS_H
+
+#include "mesh.h"
+#include <cstddef>
+#include <vector>
+
+// Batch face normal kernels. Positions are read from a structure-of-arrays
+// copy so that AVX-512 (16 faces) or AVX2 (8 faces) can gather them per
+// iteration; AVX2 is used when the CPU supports it, AVX-512 only on request
+// (NMD_SIMD=avx512), with a scalar fallback. All kernels round identically, so normals do
+// not depend on the CPU. Degenerate faces (zero or non-finite area) get a
+// zero normal instead of NaN.
+
+// Vertex positions split into one array per coordinate
+struct PositionsSoA {
+    std::vector<float> x, y, z;
+};
+
+PositionsSoA makePositionsSoA(const std::vector<glm::vec3>& vertices);
+
+// normals[f] = unit normal of face f of indices (3 per face), f < numFaces
+void computeFaceNormals(const PositionsSoA& positions, const int* indices, size_t numFaces, glm::vec3* normals);
+
+// Recompute mesh.faceNormals for every face (parallel over face blocks)
+void computeFaceNormals(Mesh& mesh);
+
+// Kernel in use: "avx512", "avx2" or "scalar". NMD_SIMD=avx512/avx2/scalar picks
+// it (default avx2), capped by what the CPU supports.
+const char* faceNormalKernelName();
+
+#endif
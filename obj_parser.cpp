@@ -0,0 +1,175 @@
+#include "obj_parser.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool isDigit(char c) {
+    return static_cast<unsigned>(c - '0') < 10u;
+}
+
+inline const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+// Powers of ten that are exact in single precision
+const float kPow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+// Fallback for numbers outside the exact fast path: copy the token to a
+// stack buffer so strtof never reads past the mapped range
+float slowParseFloat(const char* begin, const char* end) {
+    char buffer[64];
+    size_t len = static_cast<size_t>(end - begin);
+    if (len < sizeof(buffer)) {
+        std::memcpy(buffer, begin, len);
+        buffer[len] = '\0';
+        return std::strtof(buffer, nullptr);
+    }
+    return std::strtof(std::string(begin, end).c_str(), nullptr);
+}
+
+// Scan a decimal float at p. Returns the position after the number, or
+// nullptr if there is no number. Mantissas up to 2^24 with a decimal
+// exponent within +-10 are converted with a single correctly rounded
+// float operation, which gives the same bits as strtof / operator>>.
+const char* scanFloat(const char* p, const char* end, float& out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;        // significant digits accumulated into mantissa
+    int exponent = 0;
+    bool anyDigit = false;
+
+    for (; p < end && isDigit(*p); ++p) {
+        anyDigit = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            if (mantissa != 0) ++digits;
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        for (; p < end && isDigit(*p); ++p) {
+            anyDigit = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                if (mantissa != 0) ++digits;
+                --exponent;
+            }
+        }
+    }
+    if (!anyDigit) {
+        return nullptr;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool expNegative = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            expNegative = (*q == '-');
+            ++q;
+        }
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); ++q) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+            }
+            exponent += expNegative ? -e : e;
+            p = q;
+        }
+    }
+
+    if (mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10) {
+        float value = static_cast<float>(mantissa);
+        value = exponent < 0 ? value / kPow10[-exponent] : value * kPow10[exponent];
+        out = negative ? -value : value;
+    } else {
+        out = slowParseFloat(start, p);
+    }
+    return p;
+}
+
+// Scan a (possibly signed) integer at p, like std::stoi. Returns nullptr if
+// there is no number.
+const char* scanInt(const char* p, const char* end, int& out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p >= end || !isDigit(*p)) {
+        return nullptr;
+    }
+    int64_t value = 0;
+    for (; p < end && isDigit(*p); ++p) {
+        if (value < INT32_MAX) value = value * 10 + (*p - '0');
+    }
+    out = static_cast<int>(negative ? -value : value);
+    return p;
+}
+
+void parseVertex(const char* p, const char* lineEnd, OBJRecords& out) {
+    float xyz[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 3; ++i) {
+        p = skipSpace(p, lineEnd);
+        const char* next = scanFloat(p, lineEnd, xyz[i]);
+        if (!next) break;
+        p = next;
+    }
+    out.positions.emplace_back(xyz[0], xyz[1], xyz[2]);
+}
+
+void parseFace(const char* p, const char* lineEnd, OBJRecords& out) {
+    int indices[3];
+    int count = 0;
+    while (count < 3) {
+        p = skipSpace(p, lineEnd);
+        if (p >= lineEnd) break;
+        const char* next = scanInt(p, lineEnd, indices[count]);
+        if (!next) break;
+        indices[count++] -= 1;
+        // Skip "/vt/vn" up to the end of the token
+        p = next;
+        while (p < lineEnd && !isSpace(*p)) ++p;
+    }
+    if (count < 3) {
+        out.skippedFaces++;
+        return;
+    }
+    out.faces.push_back(indices[0]);
+    out.faces.push_back(indices[1]);
+    out.faces.push_back(indices[2]);
+}
+
+} // namespace
+
+void parseOBJRecords(const char* begin, const char* end, OBJRecords& out)
+{
+    const char* p = begin;
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!lineEnd) lineEnd = end;
+
+        if (lineEnd - p >= 2 && p[1] == ' ') {
+            if (p[0] == 'v') {
+                parseVertex(p + 2, lineEnd, out);
+            } else if (p[0] == 'f') {
+                parseFace(p + 2, lineEnd, out);
+            }
+        }
+        p = lineEnd + 1;
+    }
+}
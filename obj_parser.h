@@ -0,0 +1,20 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Raw OBJ records, in file order, before any vertex welding
+struct OBJRecords {
+    std::vector<glm::vec3> positions;   // One entry per "v" line
+    std::vector<int> faces;             // 3 zero-based position indices per "f" line
+    int skippedFaces = 0;               // "f" lines with fewer than 3 vertices
+};
+
+// Parse the "v" and "f" lines in [begin, end) without allocating per line.
+// begin must point at the start of a line. Follows the same rules as the
+// stream loader: only lines starting with "v " / "f " are read, faces keep
+// their first 3 vertices and texture/normal indices after '/' are ignored.
+void parseOBJRecords(const char* begin, const char* end, OBJRecords& out);
+
+#endif
@@ -0,0 +1,220 @@
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+ThreadPool::ThreadPool(unsigned numThreads)
+{
+    workers_.reserve(numThreads);
+    for (unsigned i = 0; i < numThreads; ++i) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+    // Without workers (NMD_THREADS=1) nothing would ever run the job
+    if (workers_.empty()) {
+        job();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (stopping_ && jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop();
+        }
+        job();
+    }
+}
+
+ThreadPool& defaultThreadPool()
+{
+    static ThreadPool pool([]() {
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        if (const char* env = std::getenv("NMD_THREADS")) {
+            int requested = std::atoi(env);
+            if (requested > 0) threads = static_cast<unsigned>(requested);
+        }
+        return threads - 1;
+    }());
+    return pool;
+}
+
+unsigned parallelism()
+{
+    return defaultThreadPool().size() + 1;
+}
+
+void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+
+    ThreadPool& pool = defaultThreadPool();
+    size_t chunks = std::min((count + grain - 1) / grain, static_cast<size_t>(pool.size() + 1) * 4);
+    if (chunks <= 1) {
+        body(0, count);
+        return;
+    }
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    chunks = (count + chunkSize - 1) / chunkSize;
+
+    // Shared so that helpers which start after all chunks are claimed
+    // still see valid state; they never touch `body` in that case
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    const auto* bodyPtr = &body;
+
+    auto work = [state, bodyPtr, count, chunkSize, chunks]() {
+        size_t chunk;
+        while ((chunk = state->next.fetch_add(1)) < chunks) {
+            size_t begin = chunk * chunkSize;
+            (*bodyPtr)(begin, std::min(count, begin + chunkSize));
+            if (state->done.fetch_add(1) + 1 == chunks) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(pool.size(), chunks - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        pool.enqueue(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&]() { return state->done.load() == chunks; });
+}
+
+void parallelRadixSort(std::vector<uint64_t>& keys, std::vector<int>& values, int keyBits)
+{
+    TRACE_FUNCTION();
+    const size_t n = keys.size();
+    const int digitBits = 8;
+    const size_t radix = size_t(1) << digitBits;
+    const size_t blockSize = 1 << 16;
+    const size_t numBlocks = (n + blockSize - 1) / blockSize;
+    if (n <= 1) {
+        return;
+    }
+
+    std::vector<uint64_t> keysTmp(n);
+    std::vector<int> valuesTmp(n);
+    std::vector<size_t> offsets(numBlocks * radix);
+
+    for (int shift = 0; shift < keyBits; shift += digitBits) {
+        // Per-block digit histograms
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+            for (size_t b = blockBegin; b < blockEnd; ++b) {
+                size_t* counts = &offsets[b * radix];
+                for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); ++i) {
+                    counts[(keys[i] >> shift) & (radix - 1)]++;
+                }
+            }
+        });
+
+        // Digit-major, block-minor prefix sum keeps the scatter stable
+        size_t running = 0;
+        bool singleDigit = false;
+        for (size_t d = 0; d < radix; ++d) {
+            size_t digitTotal = 0;
+            for (size_t b = 0; b < numBlocks; ++b) {
+                size_t count = offsets[b * radix + d];
+                offsets[b * radix + d] = running;
+                running += count;
+                digitTotal += count;
+            }
+            singleDigit |= (digitTotal == n);
+        }
+        if (singleDigit) {
+            // Every key has the same digit: this pass would not move anything
+            continue;
+        }
+
+        parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+            for (size_t b = blockBegin; b < blockEnd; ++b) {
+                size_t* cursor = &offsets[b * radix];
+                for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); ++i) {
+                    size_t dst = cursor[(keys[i] >> shift) & (radix - 1)]++;
+                    keysTmp[dst] = keys[i];
+                    valuesTmp[dst] = values[i];
+                }
+            }
+        });
+        keys.swap(keysTmp);
+        values.swap(valuesTmp);
+    }
+}
+
+// Path halving. Parents only ever point to smaller indices, so concurrent
+// CAS updates cannot create cycles.
+int unionFindRoot(std::vector<std::atomic<int>>& parent, int x)
+{
+    for (;;) {
+        int p = parent[x].load(std::memory_order_relaxed);
+        if (p == x) {
+            return x;
+        }
+        int grandparent = parent[p].load(std::memory_order_relaxed);
+        if (grandparent != p) {
+            parent[x].compare_exchange_weak(p, grandparent, std::memory_order_relaxed);
+        }
+        x = grandparent;
+    }
+}
+
+// Link the larger root under the smaller one; retry if another thread won
+void unionFindUnite(std::vector<std::atomic<int>>& parent, int a, int b)
+{
+    for (;;) {
+        a = unionFindRoot(parent, a);
+        b = unionFindRoot(parent, b);
+        if (a == b) {
+            return;
+        }
+        if (a < b) {
+            std::swap(a, b);
+        }
+        int expected = a;
+        if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size pool of worker threads
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+    // Queue a job with no result (run right away if the pool has no workers)
+    void enqueue(std::function<void()> job);
+
+    // Queue a job and get a future for its result
+    template <typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+// Process-wide pool with one worker per extra hardware thread.
+// The NMD_THREADS environment variable overrides the total thread count.
+ThreadPool& defaultThreadPool();
+
+// Number of threads parallelFor uses (pool workers + calling thread)
+unsigned parallelism();
+
+// Run body(begin, end) over [0, count) in chunks of at least `grain` items.
+// The calling thread claims chunks too, so parallelFor may be called from
+// inside a pool job without deadlocking.
+void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+// Stable LSD radix sort of keys on their low `keyBits` bits, moving values
+// along with them. Equal keys keep their input order, so the result is the
+// same for any thread count.
+void parallelRadixSort(std::vector<uint64_t>& keys, std::vector<int>& values, int keyBits);
+
+// Lock-free union-find over parent[], which starts as parent[i] = i. Roots are
+// always the smallest index of their set, so the final sets and roots are the
+// same whatever order concurrent unites run in.
+int unionFindRoot(std::vector<std::atomic<int>>& parent, int x);
+void unionFindUnite(std::vector<std::atomic<int>>& parent, int a, int b);
+
+#endif
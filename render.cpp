@@ -0,0 +1,76 @@
+#include "render.h"
+#include <glad/glad.h>
+
+// Fill a buffer texture's storage and (re)attach it with the given format
+static void uploadTextureBuffer(unsigned int& buffer, unsigned int& texture, GLenum format,
+                                const void* data, size_t bytes)
+{
+    if (buffer == 0) glGenBuffers(1, &buffer);
+    if (texture == 0) glGenTextures(1, &texture);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STATIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void prepareMeshForGL(const Mesh& mesh, RenderMesh& renderMesh)
+{
+    renderMesh.indexCount = static_cast<int>(mesh.indices.size() / 3 * 3);
+
+    if (renderMesh.VAO == 0) glGenVertexArrays(1, &renderMesh.VAO);
+    if (renderMesh.VBO == 0) glGenBuffers(1, &renderMesh.VBO);
+    if (renderMesh.EBO == 0) glGenBuffers(1, &renderMesh.EBO);
+
+    // Positions and indices go up as stored in the mesh, no repacking
+    glBindVertexArray(renderMesh.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderMesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER,
+                 mesh.vertices.size() * sizeof(glm::vec3),
+                 mesh.vertices.data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderMesh.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 renderMesh.indexCount * sizeof(int),
+                 mesh.indices.data(),
+                 GL_STATIC_DRAW);
+
+    // Position attribute (location 0)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+
+    // Per-face streams
+    uploadTextureBuffer(renderMesh.normalBuffer, renderMesh.normalTexture, GL_R32F,
+                        mesh.faceNormals.data(), mesh.faceNormals.size() * sizeof(glm::vec3));
+    uploadTextureBuffer(renderMesh.classBuffer, renderMesh.classTexture, GL_R8UI,
+                        mesh.boundaryClass.data(), mesh.boundaryClass.size());
+}
+
+void drawMesh(const RenderMesh& renderMesh)
+{
+    glActiveTexture(GL_TEXTURE0 + kFaceNormalTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, renderMesh.normalTexture);
+    glActiveTexture(GL_TEXTURE0 + kFaceClassTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, renderMesh.classTexture);
+
+    glBindVertexArray(renderMesh.VAO);
+    glDrawElements(GL_TRIANGLES, renderMesh.indexCount, GL_UNSIGNED_INT, (void*)0);
+}
+
+void releaseMeshGL(RenderMesh& renderMesh)
+{
+    if (renderMesh.VAO != 0) glDeleteVertexArrays(1, &renderMesh.VAO);
+    for (unsigned int* buffer : {&renderMesh.VBO, &renderMesh.EBO, &renderMesh.normalBuffer, &renderMesh.classBuffer}) {
+        if (*buffer != 0) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    for (unsigned int* texture : {&renderMesh.normalTexture, &renderMesh.classTexture}) {
+        if (*texture != 0) glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+    renderMesh.VAO = 0;
+    renderMesh.indexCount = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "mesh.h"
+#include <vector>
+
+// GPU-side state of one mesh: indexed positions plus per-face streams that
+// the fragment shader reads through buffer textures with gl_PrimitiveID
+struct RenderMesh {
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;                 // Positions, one per unique vertex
+    unsigned int EBO = 0;                 // mesh.indices
+    unsigned int normalBuffer = 0, normalTexture = 0;        // R32F, 3 per face
+    unsigned int classBuffer = 0, classTexture = 0;          // R8UI boundary class, 1 per face
+    int indexCount = 0;
+};
+
+// Texture units the per-face streams are bound to while drawing
+// (set the shader's faceNormals / faceClasses samplers to these)
+const int kFaceNormalTextureUnit = 0;
+const int kFaceClassTextureUnit = 1;
+
+// Upload the mesh's vertices, indices, face normals and boundary classes.
+// Only needed after the topology changes: the highlighted class is the
+// shader's highlightClass uniform (1/2/3 = faces with 1/2/3 boundary edges, 0 = none).
+void prepareMeshForGL(const Mesh& mesh, RenderMesh& renderMesh);
+
+// Draw a mesh prepared with prepareMeshForGL
+void drawMesh(const RenderMesh& renderMesh);
+
+// Delete the GPU buffers of a mesh
+void releaseMeshGL(RenderMesh& renderMesh);
+
+#endif
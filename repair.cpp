@@ -0,0 +1,236 @@
+#include "repair.h"
+#include "parallel.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+// Fan of every corner: corners at the same vertex are joined across the
+// edges the surface continues over. Those are the edges with two faces and,
+// with pairFaces, pairs of faces running along a non-manifold edge in
+// opposite directions (taken in face order); the remaining faces of a
+// non-manifold edge are cut off. Each fan is named by its root, the fan's
+// smallest corner.
+std::vector<int> findFans(const Mesh& mesh, bool pairFaces)
+{
+    TRACE_FUNCTION();
+    const size_t numCorners = mesh.indices.size() / 3 * 3;
+    const EdgeTable& edges = mesh.edgeToFaces;
+    const HalfEdges& halfEdges = mesh.halfEdges;
+    const size_t grain = 1 << 14;
+
+    std::vector<std::atomic<int>> parent(numCorners);
+    parallelFor(numCorners, grain, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            parent[c].store(static_cast<int>(c), std::memory_order_relaxed);
+        }
+    });
+
+    // Join the corners at both ends of half-edge h with the corners at the
+    // same vertices in the face of half-edge t (same edge, either direction)
+    auto joinAcross = [&](int h, int t) {
+        for (int corner : {h, nextHalfEdge(h)}) {
+            const int v = mesh.indices[corner];
+            const int other = mesh.indices[t] == v ? t : nextHalfEdge(t);
+            if (mesh.indices[other] == v) {
+                unionFindUnite(parent, corner, other);
+            }
+        }
+    };
+    parallelFor(numCorners, grain, [&](size_t begin, size_t end) {
+        for (size_t h = begin; h < end; ++h) {
+            const int twin = halfEdges.twins[h];
+            if (twin > static_cast<int>(h)) joinAcross(static_cast<int>(h), twin);
+        }
+    });
+    parallelFor(pairFaces ? edges.size() : 0, grain, [&](size_t begin, size_t end) {
+        std::vector<int> along;
+        for (size_t e = begin; e < end; ++e) {
+            if (edges.faceCount(static_cast<int>(e)) < 3) continue;
+            along.clear();
+            for (const int* f = edges.facesBegin(static_cast<int>(e)); f != edges.facesEnd(static_cast<int>(e)); ++f) {
+                for (int h = *f * 3; h < *f * 3 + 3; ++h) {
+                    if (edges.cornerEdges[h] == static_cast<int>(e)) {
+                        along.push_back(h);
+                        break;
+                    }
+                }
+            }
+            for (size_t i = 0; i < along.size(); ++i) {
+                if (along[i] < 0) continue;
+                for (size_t j = i + 1; j < along.size(); ++j) {
+                    if (along[j] >= 0 && mesh.indices[along[j]] != mesh.indices[along[i]]) {
+                        joinAcross(along[i], along[j]);
+                        along[j] = -1;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    std::vector<int> fan(numCorners);
+    parallelFor(numCorners, grain, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            fan[c] = unionFindRoot(parent, static_cast<int>(c));
+        }
+    });
+    return fan;
+}
+
+bool hasNonManifoldEdges(const EdgeTable& edges)
+{
+    for (size_t e = 0; e < edges.size(); ++e) {
+        if (edges.faceCount(static_cast<int>(e)) > 2) return true;
+    }
+    return false;
+}
+
+// Faces in every fan but the largest (the first on ties) of vertices with
+// more than one fan, in face order
+std::vector<int> smallFanFaces(const Mesh& mesh, const std::vector<int>& fan)
+{
+    TRACE_FUNCTION();
+    const size_t numVertices = mesh.vertices.size();
+    const HalfEdges& halfEdges = mesh.halfEdges;
+
+    // A fan's root is a corner of the same vertex, so each vertex only
+    // touches its own entries of fanSize
+    std::vector<int> fanSize(fan.size(), 0);
+    std::vector<int> keptFan(numVertices, -1);
+    parallelFor(numVertices, 1 << 12, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            const int* first = halfEdges.cornersBegin(static_cast<int>(v));
+            const int* last = halfEdges.cornersEnd(static_cast<int>(v));
+            int numFans = 0;
+            for (const int* c = first; c != last; ++c) {
+                fanSize[fan[*c]]++;
+                numFans += fan[*c] == *c;
+            }
+            if (numFans < 2) continue;
+            int kept = -1;
+            for (const int* c = first; c != last; ++c) {
+                if (fan[*c] == *c && (kept < 0 || fanSize[*c] > fanSize[kept])) kept = *c;
+            }
+            keptFan[v] = kept;
+        }
+    });
+
+    std::vector<int> faces;
+    const size_t numFaces = mesh.indices.size() / 3;
+    for (size_t f = 0; f < numFaces; ++f) {
+        for (size_t c = f * 3; c < f * 3 + 3; ++c) {
+            const int kept = keptFan[mesh.indices[c]];
+            if (kept >= 0 && fan[c] != kept) {
+                faces.push_back(static_cast<int>(f));
+                break;
+            }
+        }
+    }
+    return faces;
+}
+
+// Give every fan after the first (the one with the vertex's smallest corner)
+// its own copy of the vertex, numbered after the existing vertices in vertex
+// order. Returns the number of vertices added.
+int splitFans(Mesh& mesh, const std::vector<int>& fan)
+{
+    TRACE_FUNCTION();
+    const size_t numVertices = mesh.vertices.size();
+    const HalfEdges& halfEdges = mesh.halfEdges;
+
+    std::vector<int> firstCopy(numVertices + 1, 0);
+    parallelFor(numVertices, 1 << 12, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            int numFans = 0;
+            for (const int* c = halfEdges.cornersBegin(static_cast<int>(v)); c != halfEdges.cornersEnd(static_cast<int>(v)); ++c) {
+                numFans += fan[*c] == *c;
+            }
+            firstCopy[v + 1] = numFans > 1 ? numFans - 1 : 0;
+        }
+    });
+    for (size_t v = 0; v < numVertices; ++v) {
+        firstCopy[v + 1] += firstCopy[v];
+    }
+    const int added = firstCopy[numVertices];
+    if (added == 0) {
+        return 0;
+    }
+
+    // Vertex of every fan, stored at the fan's root corner
+    std::vector<int> fanVertex(fan.size(), -1);
+    mesh.vertices.resize(numVertices + added);
+    parallelFor(numVertices, 1 << 12, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            int next = static_cast<int>(numVertices) + firstCopy[v];
+            bool first = true;
+            for (const int* c = halfEdges.cornersBegin(static_cast<int>(v)); c != halfEdges.cornersEnd(static_cast<int>(v)); ++c) {
+                if (fan[*c] != *c) continue;
+                if (first) {
+                    fanVertex[*c] = static_cast<int>(v);
+                    first = false;
+                } else {
+                    mesh.vertices[next] = mesh.vertices[v];
+                    fanVertex[*c] = next++;
+                }
+            }
+        }
+    });
+    parallelFor(fan.size(), 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            mesh.indices[c] = fanVertex[fan[c]];
+        }
+    });
+    return added;
+}
+
+} // namespace
+
+RepairResult repairNonManifold(Mesh& mesh, const RepairSettings& settings, const ProgressCallback& progress)
+{
+    TRACE_FUNCTION();
+    RepairResult result;
+    if (mesh.indices.empty()) {
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    result.before = analyzeMesh(mesh.edgeToFaces);
+
+    // Dropping and the two split rounds are a third of the work each
+    bool cancelled = false;
+    if (settings.dropSmallFans) {
+        std::vector<int> faces = smallFanFaces(mesh, findFans(mesh, true));
+        if (!faces.empty()) {
+            removeFaces(mesh, faces);
+            result.droppedFaces = static_cast<int>(faces.size());
+        }
+        cancelled = !reportProgress(progress, 1.0f / 3.0f);
+    }
+    // The first round keeps one sheet going through each non-manifold edge.
+    // A fan can wrap around its vertex back onto the same edge; the second
+    // round cuts every face off the edges that are still non-manifold.
+    // Faces keep their order and shape, so the normals stay valid.
+    for (bool pairFaces : {true, false}) {
+        if (cancelled) break;
+        const int added = splitFans(mesh, findFans(mesh, pairFaces));
+        cancelled = !reportProgress(progress, pairFaces ? 2.0f / 3.0f : 1.0f);
+        if (added == 0) continue;
+        result.splitVertices += added;
+        mesh.edgeToFaces = buildEdgeFaceAdjacency(mesh);
+        mesh.halfEdges = buildHalfEdges(mesh);
+        if (!hasNonManifoldEdges(mesh.edgeToFaces)) break;
+    }
+    result.after = analyzeMesh(mesh.edgeToFaces);
+    if (result.splitVertices > 0) {
+        findBoundaryFaces(mesh);
+    }
+    TRACE_COUNT(trace::Counter::FacesProcessed, mesh.indices.size() / 3);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Repaired non-manifold geometry: split off " << result.splitVertices << " vertices, dropped "
+              << result.droppedFaces << " faces; non-manifold edges " << result.before.nonManifoldTotal() << " -> "
+              << result.after.nonManifoldTotal() << " in " << ms << " ms\n";
+    return result;
+}
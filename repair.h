@@ -0,0 +1,29 @@
+#ifndef REPAIR_H
+#define REPAIR_H
+
+#include "mesh.h"
+
+struct RepairSettings {
+    bool dropSmallFans = false;     // Remove the faces of all but the largest fan
+                                    // of each non-manifold vertex before splitting
+};
+
+struct RepairResult {
+    EdgeStats before;               // analyzeMesh counts before the repair
+    EdgeStats after;                // ... and after
+    int splitVertices = 0;          // Vertices added for extra fans
+    int droppedFaces = 0;           // Faces removed with dropSmallFans
+};
+
+// Make the mesh manifold by cutting it along non-manifold edges and at
+// non-manifold vertices. The corners around each vertex are grouped into fans
+// (corners joined across edges with exactly two faces); every fan after the
+// first gets its own copy of the vertex. With dropSmallFans, the smaller fans
+// at a vertex are deleted instead, and anything left over is then split.
+// One union-find pass over the half-edges, no edge lookups; faces keep their
+// order. Rebuilds the adjacency and boundary classification afterwards.
+// progress is called after each step; if it cancels, the steps done so far are kept.
+RepairResult repairNonManifold(Mesh& mesh, const RepairSettings& settings = RepairSettings(),
+                               const ProgressCallback& progress = ProgressCallback());
+
+#endif
@@ -2,28 +2,38 @@
 out vec4 FragColor;
 
 in vec3 FragPos;
-in vec3 Normal;
-in float IsBoundary;
 
+uniform mat3 normalMatrix;              // transpose(inverse(mat3(modelMatrix))), set by the CPU
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 uniform vec3 objectColor;
 uniform vec3 boundaryColor;
+uniform int highlightClass;            // Boundary class to highlight (0 = none)
+
+// Per-face streams, indexed by gl_PrimitiveID (= face index)
+uniform samplerBuffer faceNormals;     // 3 floats per face
+uniform usamplerBuffer faceClasses;    // Boundary edges per face (0-3)
 
 void main()
 {
+    int face = gl_PrimitiveID;
+    vec3 faceNormal = vec3(texelFetch(faceNormals, face * 3).r,
+                           texelFetch(faceNormals, face * 3 + 1).r,
+                           texelFetch(faceNormals, face * 3 + 2).r);
+    float isBoundary = (highlightClass != 0 && int(texelFetch(faceClasses, face).r) == highlightClass) ? 1.0 : 0.0;
+
     // Ambient
     float ambientStrength = 0.1;
     vec3 ambient = ambientStrength * vec3(1.0);
     
     // Diffuse
-    vec3 norm = normalize(Normal);
+    vec3 norm = normalize(normalMatrix * faceNormal);
     vec3 lightDir = normalize(lightPos - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * vec3(1.0);
     
     // Choose color based on boundary flag
-    vec3 color = mix(objectColor, boundaryColor, IsBoundary);
+    vec3 color = mix(objectColor, boundaryColor, isBoundary);
     
     vec3 result = (ambient + diffuse) * color;
     FragColor = vec4(result, 1.0);
@@ -0,0 +1,138 @@
+#include "smooth.h"
+#include "normals.h"
+#include "parallel.h"
+#include "trace.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+// Uniform Laplacian as a CSR matrix: row v holds v's one-ring neighbors with
+// weight 1 / degree. Pinned and isolated vertices have empty rows.
+struct LaplacianCSR {
+    std::vector<size_t> offsets;
+    std::vector<int> columns;
+    std::vector<float> values;
+};
+
+// True if v has a boundary edge (an edge with one face)
+bool onBoundary(const Mesh& mesh, int v)
+{
+    const HalfEdges& halfEdges = mesh.halfEdges;
+    for (const int* c = halfEdges.cornersBegin(v); c != halfEdges.cornersEnd(v); ++c) {
+        if (halfEdges.twins[*c] == kBoundaryHalfEdge || halfEdges.twins[prevHalfEdge(*c)] == kBoundaryHalfEdge) {
+            return true;
+        }
+    }
+    return false;
+}
+
+LaplacianCSR buildLaplacian(const Mesh& mesh, bool pinBoundary, int& pinned)
+{
+    TRACE_FUNCTION();
+    const size_t numVertices = mesh.vertices.size();
+    LaplacianCSR laplacian;
+    laplacian.offsets.assign(numVertices + 1, 0);
+    std::vector<char> fixed(numVertices, 0);
+    parallelFor(numVertices, 1 << 12, [&](size_t begin, size_t end) {
+        std::vector<int> ring;
+        for (size_t v = begin; v < end; ++v) {
+            if (pinBoundary && onBoundary(mesh, static_cast<int>(v))) {
+                fixed[v] = 1;
+                continue;
+            }
+            vertexOneRing(mesh, static_cast<int>(v), ring);
+            laplacian.offsets[v + 1] = ring.size();
+        }
+    });
+    pinned = 0;
+    for (size_t v = 0; v < numVertices; ++v) {
+        laplacian.offsets[v + 1] += laplacian.offsets[v];
+        pinned += fixed[v];
+    }
+    laplacian.columns.resize(laplacian.offsets[numVertices]);
+    laplacian.values.resize(laplacian.offsets[numVertices]);
+    parallelFor(numVertices, 1 << 12, [&](size_t begin, size_t end) {
+        std::vector<int> ring;
+        for (size_t v = begin; v < end; ++v) {
+            const size_t row = laplacian.offsets[v];
+            const size_t degree = laplacian.offsets[v + 1] - row;
+            if (degree == 0) continue;
+            vertexOneRing(mesh, static_cast<int>(v), ring);
+            for (size_t k = 0; k < degree; ++k) {
+                laplacian.columns[row + k] = ring[k];
+                laplacian.values[row + k] = 1.0f / static_cast<float>(degree);
+            }
+        }
+    });
+    return laplacian;
+}
+
+// out = in + step * (L in - in) on rows with neighbors, in elsewhere
+void laplacianStep(const LaplacianCSR& laplacian, float step, const PositionsSoA& in, PositionsSoA& out)
+{
+    const size_t numVertices = in.x.size();
+    parallelFor(numVertices, 1 << 14, [&](size_t begin, size_t end) {
+        const size_t* offsets = laplacian.offsets.data();
+        const int* columns = laplacian.columns.data();
+        const float* values = laplacian.values.data();
+        for (size_t v = begin; v < end; ++v) {
+            float x = in.x[v], y = in.y[v], z = in.z[v];
+            if (offsets[v + 1] > offsets[v]) {
+                float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+                for (size_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+                    const int u = columns[k];
+                    sx += values[k] * in.x[u];
+                    sy += values[k] * in.y[u];
+                    sz += values[k] * in.z[u];
+                }
+                x += step * (sx - x);
+                y += step * (sy - y);
+                z += step * (sz - z);
+            }
+            out.x[v] = x;
+            out.y[v] = y;
+            out.z[v] = z;
+        }
+    });
+}
+
+} // namespace
+
+void taubinSmooth(Mesh& mesh, const TaubinSettings& settings, const ProgressCallback& progress)
+{
+    TRACE_FUNCTION();
+    const size_t numVertices = mesh.vertices.size();
+    if (numVertices == 0 || settings.iterations <= 0) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    int pinned = 0;
+    const LaplacianCSR laplacian = buildLaplacian(mesh, settings.pinBoundary, pinned);
+
+    // Coordinates as separate arrays, ping-ponged between the two buffers
+    PositionsSoA current = makePositionsSoA(mesh.vertices);
+    PositionsSoA next = current;
+    for (int iteration = 0; iteration < settings.iterations; ++iteration) {
+        TRACE_ZONE("taubinIteration");
+        laplacianStep(laplacian, settings.lambda, current, next);
+        laplacianStep(laplacian, settings.mu, next, current);
+        if (!reportProgress(progress, static_cast<float>(iteration + 1) / settings.iterations)) {
+            return;
+        }
+    }
+
+    parallelFor(numVertices, 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            mesh.vertices[v] = glm::vec3(current.x[v], current.y[v], current.z[v]);
+        }
+    });
+    computeFaceNormals(mesh);
+    TRACE_COUNT(trace::Counter::FacesProcessed, mesh.indices.size() / 3);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Taubin smoothed " << numVertices << " vertices (" << pinned << " pinned): "
+              << settings.iterations << " iterations (lambda " << settings.lambda << ", mu " << settings.mu
+              << ") in " << ms << " ms\n";
+}
@@ -0,0 +1,22 @@
+#ifndef SMOOTH_H
+#define SMOOTH_H
+
+#include "mesh.h"
+
+struct TaubinSettings {
+    int iterations = 10;        // Each iteration is one lambda and one mu step
+    float lambda = 0.5f;        // Shrinking step (positive)
+    float mu = -0.53f;          // Inflating step (negative, |mu| > lambda)
+    bool pinBoundary = true;    // Keep vertices on boundary edges in place
+};
+
+// Taubin lambda/mu smoothing of mesh.vertices with the uniform Laplacian.
+// The one-ring operator is built once as a CSR sparse matrix; every step is
+// then a parallel sparse matrix-vector sweep over double-buffered coordinate
+// arrays. Face normals are recomputed once at the end; topology is unchanged.
+// The result is the same for any thread count. progress is called after
+// every iteration; if it cancels, the mesh is left unchanged.
+void taubinSmooth(Mesh& mesh, const TaubinSettings& settings = TaubinSettings(),
+                  const ProgressCallback& progress = ProgressCallback());
+
+#endif
@@ -0,0 +1,198 @@
+#include "trace.h"
+
+#ifdef NMD_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+constexpr int kNumCounters = static_cast<int>(Counter::Count);
+const char* const kCounterNames[kNumCounters] = {"bytes parsed", "faces processed", "allocations", "allocated bytes"};
+
+struct ZoneEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct CounterSample {
+    uint64_t time;
+    int64_t values[kNumCounters];
+};
+
+// Only the owning thread appends; the mutex is uncontended except while
+// exporting or clearing.
+struct ThreadBuffer {
+    int id = 0;
+    std::mutex mutex;
+    std::vector<ZoneEvent> zones;
+    std::vector<CounterSample> samples;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+// Never destroyed, so zones may still end during static destruction
+Registry& registry()
+{
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+std::atomic<int64_t> counters[kNumCounters];
+
+std::chrono::steady_clock::time_point epoch()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+// Buffers outlive their threads so pool workers' zones survive until export
+ThreadBuffer& threadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = reg.buffers.back().get();
+        buffer->id = static_cast<int>(reg.buffers.size());
+        buffer->zones.reserve(4096);
+        buffer->samples.reserve(4096);
+    }
+    return *buffer;
+}
+
+void writeEscaped(FILE* file, const char* text)
+{
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') std::fputc('\\', file);
+        std::fputc(*text, file);
+    }
+}
+
+} // namespace
+
+uint64_t now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch()).count());
+}
+
+void count(Counter counter, int64_t delta)
+{
+    counters[static_cast<int>(counter)].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void recordZone(const char* name, uint64_t start)
+{
+    uint64_t end = now();
+    CounterSample sample;
+    sample.time = end;
+    for (int i = 0; i < kNumCounters; ++i) {
+        sample.values[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.zones.push_back({name, start, end});
+    buffer.samples.push_back(sample);
+}
+
+bool writeChromeTrace(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> registryLock(reg.mutex);
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) std::fputs(",\n", file);
+        first = false;
+    };
+
+    std::vector<CounterSample> samples;
+    for (const auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        separator();
+        std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                     buffer->id, buffer->id);
+        for (const ZoneEvent& zone : buffer->zones) {
+            separator();
+            std::fputs("{\"name\":\"", file);
+            writeEscaped(file, zone.name);
+            std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         buffer->id, zone.start / 1000.0, (zone.end - zone.start) / 1000.0);
+        }
+        samples.insert(samples.end(), buffer->samples.begin(), buffer->samples.end());
+    }
+
+    // Counters are process-wide: merge the samples of all threads in time order
+    std::sort(samples.begin(), samples.end(),
+              [](const CounterSample& a, const CounterSample& b) { return a.time < b.time; });
+    for (const CounterSample& sample : samples) {
+        for (int i = 0; i < kNumCounters; ++i) {
+            separator();
+            std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                         kCounterNames[i], sample.time / 1000.0, static_cast<long long>(sample.values[i]));
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    bool ok = std::ferror(file) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
+
+void clear()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> registryLock(reg.mutex);
+    for (const auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->zones.clear();
+        buffer->samples.clear();
+    }
+    for (auto& counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace trace
+
+// Count every heap allocation. The array and nothrow forms forward here.
+void* operator new(std::size_t size)
+{
+    trace::count(trace::Counter::Allocations, 1);
+    trace::count(trace::Counter::AllocatedBytes, static_cast<int64_t>(size));
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
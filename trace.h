@@ -0,0 +1,75 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped tracing for the mesh pipeline. Compile with -DNMD_TRACE to enable;
+// otherwise every macro below expands to nothing.
+//
+//   TRACE_FUNCTION();                          zone named after the function
+//   TRACE_ZONE("weld shard");                  zone with an explicit name
+//   TRACE_COUNT(trace::Counter::Faces, n);     add to a counter
+//   TRACE_EXPORT("trace.json");                write Chrome / Perfetto JSON
+//
+// Zones go to per-thread buffers. Counters are process-wide and sampled
+// whenever a zone ends, so they show up as counter tracks in the viewer.
+
+#ifdef NMD_TRACE
+
+#include <cstdint>
+#include <string>
+
+namespace trace {
+
+enum class Counter {
+    BytesParsed,
+    FacesProcessed,
+    Allocations,
+    AllocatedBytes,
+    Count
+};
+
+// Nanoseconds since the trace epoch (process start)
+uint64_t now();
+
+void count(Counter counter, int64_t delta);
+
+// Records [start, now()) on the calling thread's buffer
+void recordZone(const char* name, uint64_t start);
+
+// Write everything recorded so far (call while no zones are being recorded)
+bool writeChromeTrace(const std::string& path);
+
+// Drop all recorded events and reset the counters
+void clear();
+
+class Zone {
+public:
+    explicit Zone(const char* name) : name_(name), start_(now()) {}
+    ~Zone() { recordZone(name_, start_); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
+
+} // namespace trace
+
+#define NMD_TRACE_CONCAT_(a, b) a##b
+#define NMD_TRACE_CONCAT(a, b) NMD_TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) trace::Zone NMD_TRACE_CONCAT(traceZone_, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_ZONE(__func__)
+#define TRACE_COUNT(counter, delta) trace::count(counter, static_cast<int64_t>(delta))
+#define TRACE_EXPORT(path) trace::writeChromeTrace(path)
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_FUNCTION() ((void)0)
+#define TRACE_COUNT(counter, delta) ((void)0)
+#define TRACE_EXPORT(path) ((void)0)
+
+#endif
+
+#endif
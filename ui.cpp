@@ -25,20 +25,14 @@ void renderUI(UIState& state)
 
     // Create UI panel
     ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_Always);
-    ImGui::SetNextWindowSize(ImVec2(220, 160), ImGuiCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(220, 710), ImGuiCond_Always);
     ImGui::Begin("Boundary Face Removal", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize);
 
     // Radio buttons for boundary selection
     ImGui::Text("Select faces to remove:");
-    if (ImGui::RadioButton("1 Boundary Edge", &state.boundarySelection, 0)) {
-        state.selectionChanged = true;
-    }
-    if (ImGui::RadioButton("2 Boundary Edges", &state.boundarySelection, 1)) {
-        state.selectionChanged = true;
-    }
-    if (ImGui::RadioButton("3 Boundary Edges", &state.boundarySelection, 2)) {
-        state.selectionChanged = true;
-    }
+    ImGui::RadioButton("1 Boundary Edge", &state.boundarySelection, 0);
+    ImGui::RadioButton("2 Boundary Edges", &state.boundarySelection, 1);
+    ImGui::RadioButton("3 Boundary Edges", &state.boundarySelection, 2);
     
     ImGui::Spacing();
     
@@ -50,6 +44,106 @@ void renderUI(UIState& state)
     if (ImGui::Button("Reset")) {
         state.resetClicked = true;
     }
+    if (ImGui::Button("Undo")) {
+        state.undoClicked = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Redo")) {
+        state.redoClicked = true;
+    }
+
+    ImGui::Spacing();
+
+    // Repeat removal until the border stops shrinking
+    ImGui::InputInt("Max rounds", &state.peelMaxIterations);
+    if (state.peelMaxIterations < 0) {
+        state.peelMaxIterations = 0;
+    }
+    if (ImGui::Button("Peel until stable")) {
+        state.peelClicked = true;
+    }
+
+    ImGui::Spacing();
+
+    // Drop small disconnected pieces
+    ImGui::InputInt("Min faces", &state.floaterMinFaces);
+    if (state.floaterMinFaces < 1) {
+        state.floaterMinFaces = 1;
+    }
+    if (ImGui::Button("Remove floaters")) {
+        state.removeFloatersClicked = true;
+    }
+
+    ImGui::Spacing();
+
+    // Merge near-coincident vertices
+    ImGui::InputFloat("Epsilon", &state.weldEpsilon, 0.0f, 0.0f, "%.1e");
+    if (state.weldEpsilon < 0.0f) {
+        state.weldEpsilon = 0.0f;
+    }
+    if (ImGui::Button("Weld vertices")) {
+        state.weldClicked = true;
+    }
+
+    ImGui::Spacing();
+
+    // Bilateral normal filtering, then vertex updates
+    ImGui::InputInt("Passes", &state.denoiseIterations);
+    if (state.denoiseIterations < 1) {
+        state.denoiseIterations = 1;
+    }
+    ImGui::InputFloat("Sigma", &state.denoiseSigma, 0.05f, 0.1f, "%.2f");
+    if (state.denoiseSigma < 0.01f) {
+        state.denoiseSigma = 0.01f;
+    }
+    if (ImGui::Button("Denoise")) {
+        state.denoiseClicked = true;
+    }
+
+    ImGui::Spacing();
+
+    // Taubin lambda/mu smoothing
+    ImGui::InputInt("Iterations", &state.smoothIterations);
+    if (state.smoothIterations < 1) {
+        state.smoothIterations = 1;
+    }
+    ImGui::Checkbox("Pin boundary", &state.smoothPinBoundary);
+    if (ImGui::Button("Smooth")) {
+        state.smoothClicked = true;
+    }
+
+    ImGui::Spacing();
+
+    // Quadric error edge-collapse simplification
+    ImGui::InputInt("Target faces", &state.decimateTargetFaces, 1000, 10000);
+    if (state.decimateTargetFaces < 1) {
+        state.decimateTargetFaces = 1;
+    }
+    ImGui::Checkbox("Keep boundary", &state.decimatePreserveBoundary);
+    if (ImGui::Button("Decimate")) {
+        state.decimateClicked = true;
+    }
+
+    ImGui::Spacing();
+
+    // Non-manifold edges and vertices
+    ImGui::Checkbox("Drop small fans", &state.repairDropFans);
+    if (ImGui::Button("Repair non-manifold")) {
+        state.repairClicked = true;
+    }
+
+    ImGui::Separator();
+
+    // Progress of the running edit; the viewer stays interactive meanwhile
+    if (state.jobRunning) {
+        ImGui::Text("%s...", state.jobName);
+        ImGui::ProgressBar(state.jobProgress);
+        if (ImGui::Button("Cancel")) {
+            state.cancelClicked = true;
+        }
+    } else {
+        ImGui::Text("Idle");
+    }
 
     ImGui::End();
 
@@ -7,12 +7,48 @@ struct UIState {
     // Boundary face removal: 0 = 1 edge, 1 = 2 edges
     int boundarySelection = 0;
     
-    // Set true when radio button selection changes (consume in main loop)
-    bool selectionChanged = false;
-    
-    // Action buttons (set true when clicked, consume in main loop)
+    // Action buttons (set true when clicked, consume in main loop; ignored while a job runs)
     bool removeClicked = false;
     bool resetClicked = false;
+    bool peelClicked = false;
+    bool removeFloatersClicked = false;
+    bool weldClicked = false;
+    bool denoiseClicked = false;
+    bool smoothClicked = false;
+    bool decimateClicked = false;
+    bool repairClicked = false;
+    bool undoClicked = false;
+    bool redoClicked = false;
+    bool cancelClicked = false;
+
+    // Background job status, filled in by main each frame
+    bool jobRunning = false;
+    const char* jobName = "";
+    float jobProgress = 0.0f;
+
+    // Peel until stable: maximum rounds (0 = no limit)
+    int peelMaxIterations = 0;
+
+    // Floater removal: components with fewer faces are removed
+    int floaterMinFaces = 100;
+
+    // Welding: vertices closer than this are merged
+    float weldEpsilon = 1e-5f;
+
+    // Denoising: bilateral normal filter passes and normal sigma
+    int denoiseIterations = 20;
+    float denoiseSigma = 0.35f;
+
+    // Taubin smoothing: lambda/mu iterations, boundary vertices kept in place
+    int smoothIterations = 10;
+    bool smoothPinBoundary = true;
+
+    // Decimation: target face count, boundary vertices kept in place
+    int decimateTargetFaces = 50000;
+    bool decimatePreserveBoundary = true;
+
+    // Non-manifold repair: split vertices per fan, or drop all but the largest fan
+    bool repairDropFans = false;
 };
 
 // Initialize ImGui - call once after creating GLFW window and loading OpenGL
@@ -0,0 +1,270 @@
+#include "weld.h"
+#include "normals.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+namespace {
+
+constexpr uint64_t kEmptySlot = ~0ull;
+
+struct Cell {
+    int64_t x, y, z;
+};
+
+// Grid coordinate of v along one axis; non-finite or huge values share cell 0
+// (they can never be within epsilon of anything anyway)
+int64_t cellCoord(float v, double inverseCellSize)
+{
+    double c = std::floor(static_cast<double>(v) * inverseCellSize);
+    return (c > -1e18 && c < 1e18) ? static_cast<int64_t>(c) : 0;
+}
+
+Cell cellOf(const glm::vec3& v, double inverseCellSize)
+{
+    return {cellCoord(v.x, inverseCellSize), cellCoord(v.y, inverseCellSize), cellCoord(v.z, inverseCellSize)};
+}
+
+// Strong 64-bit mix of the cell coordinates (never returns kEmptySlot)
+uint64_t hashCell(const Cell& cell)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    for (int64_t c : {cell.x, cell.y, cell.z}) {
+        h = (h ^ static_cast<uint64_t>(c)) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 29;
+    return h == kEmptySlot ? h - 1 : h;
+}
+
+// Open-addressing table (linear probing) from cell hash to the range of
+// hash-sorted vertices in that cell. Distinct cells that share a hash end up
+// in one range; the distance test filters them out.
+class CellTable {
+public:
+    explicit CellTable(size_t numCells) {
+        size_t capacity = 16;
+        while (capacity < numCells * 2) capacity <<= 1;
+        mask_ = capacity - 1;
+        keys_ = std::vector<std::atomic<uint64_t>>(capacity);
+        begins_.resize(capacity);
+        ends_.resize(capacity);
+        parallelFor(capacity, 1 << 16, [this](size_t begin, size_t end) {
+            for (size_t s = begin; s < end; ++s) keys_[s].store(kEmptySlot, std::memory_order_relaxed);
+        });
+    }
+
+    // Thread-safe as long as every key is inserted once
+    void insert(uint64_t key, int begin, int end) {
+        for (size_t slot = key & mask_;; slot = (slot + 1) & mask_) {
+            uint64_t expected = kEmptySlot;
+            if (keys_[slot].compare_exchange_strong(expected, key, std::memory_order_relaxed)) {
+                begins_[slot] = begin;
+                ends_[slot] = end;
+                return;
+            }
+        }
+    }
+
+    bool find(uint64_t key, int& begin, int& end) const {
+        for (size_t slot = key & mask_;; slot = (slot + 1) & mask_) {
+            uint64_t stored = keys_[slot].load(std::memory_order_relaxed);
+            if (stored == key) {
+                begin = begins_[slot];
+                end = ends_[slot];
+                return true;
+            }
+            if (stored == kEmptySlot) {
+                return false;
+            }
+        }
+    }
+
+private:
+    std::vector<std::atomic<uint64_t>> keys_;
+    std::vector<int> begins_;
+    std::vector<int> ends_;
+    size_t mask_ = 0;
+};
+
+// Largest absolute finite coordinate, i.e. how far the bounding box reaches
+// from the origin along any axis
+float boundingBoxReach(const std::vector<glm::vec3>& vertices)
+{
+    const size_t grain = 1 << 16;
+    const size_t numBlocks = (vertices.size() + grain - 1) / grain;
+    std::vector<float> blockReach(numBlocks, 0.0f);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            float reach = 0.0f;
+            for (size_t v = b * grain; v < std::min(vertices.size(), (b + 1) * grain); ++v) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    const float c = std::fabs(vertices[v][axis]);
+                    if (std::isfinite(c)) reach = std::max(reach, c);
+                }
+            }
+            blockReach[b] = reach;
+        }
+    });
+    return blockReach.empty() ? 0.0f : *std::max_element(blockReach.begin(), blockReach.end());
+}
+
+} // namespace
+
+WeldResult weldVertices(Mesh& mesh, float epsilon)
+{
+    TRACE_FUNCTION();
+    WeldResult result;
+    const int numVertices = static_cast<int>(mesh.vertices.size());
+    if (numVertices == 0 || !(epsilon > 0.0f)) {
+        return result;
+    }
+    // Cell coordinates past cellCoord's range all land in cell 0, which would
+    // make the neighbor search quadratic. An epsilon that small relative to
+    // the bounding box is far below float precision anyway, so raise it.
+    const float minEpsilon = boundingBoxReach(mesh.vertices) * 1e-12f;
+    if (epsilon < minEpsilon) {
+        std::cerr << "Weld epsilon " << epsilon << " is too small for this mesh, using " << minEpsilon << std::endl;
+        epsilon = minEpsilon;
+    }
+    const size_t grain = 1 << 14;
+    const double inverseCellSize = 1.0 / epsilon;
+    const float epsilon2 = epsilon * epsilon;
+
+    // Sort vertices by cell hash so every cell is one contiguous run
+    std::vector<uint64_t> keys(numVertices);
+    std::vector<int> order(numVertices);
+    parallelFor(numVertices, grain, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            keys[v] = hashCell(cellOf(mesh.vertices[v], inverseCellSize));
+            order[v] = static_cast<int>(v);
+        }
+    });
+    parallelRadixSort(keys, order, 64);
+
+    std::vector<int> runStarts;
+    for (int i = 0; i < numVertices; ++i) {
+        if (i == 0 || keys[i] != keys[i - 1]) runStarts.push_back(i);
+    }
+    runStarts.push_back(numVertices);
+    const size_t numCells = runStarts.size() - 1;
+    CellTable table(numCells);
+    parallelFor(numCells, 1 << 12, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            table.insert(keys[runStarts[c]], runStarts[c], runStarts[c + 1]);
+        }
+    });
+
+    // Join every vertex with the lower-index vertices within epsilon in the 27 surrounding cells
+    std::vector<std::atomic<int>> parent(numVertices);
+    parallelFor(numVertices, grain, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            parent[v].store(static_cast<int>(v), std::memory_order_relaxed);
+        }
+    });
+    parallelFor(numVertices, grain, [&](size_t begin, size_t end) {
+        for (size_t vi = begin; vi < end; ++vi) {
+            const int v = static_cast<int>(vi);
+            const glm::vec3& p = mesh.vertices[v];
+            const Cell cell = cellOf(p, inverseCellSize);
+            for (int dz = -1; dz <= 1; ++dz) {
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        int runBegin, runEnd;
+                        if (!table.find(hashCell({cell.x + dx, cell.y + dy, cell.z + dz}), runBegin, runEnd)) {
+                            continue;
+                        }
+                        for (int k = runBegin; k < runEnd; ++k) {
+                            int u = order[k];
+                            if (u >= v) continue;
+                            glm::vec3 d = mesh.vertices[u] - p;
+                            if (glm::dot(d, d) <= epsilon2) {
+                                unionFindUnite(parent, u, v);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    // Every root is the smallest vertex of its group; number roots in vertex order
+    std::vector<int> root(numVertices);
+    parallelFor(numVertices, grain, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            root[v] = unionFindRoot(parent, static_cast<int>(v));
+        }
+    });
+    std::vector<int> newIndex(numVertices, -1);
+    std::vector<glm::vec3> newVertices;
+    for (int v = 0; v < numVertices; ++v) {
+        if (root[v] == v) {
+            newIndex[v] = static_cast<int>(newVertices.size());
+            newVertices.push_back(mesh.vertices[v]);
+        }
+    }
+    result.mergedVertices = numVertices - static_cast<int>(newVertices.size());
+    if (result.mergedVertices == 0) {
+        std::cout << "Welded 0 vertices (epsilon " << epsilon << ")\n";
+        return result;
+    }
+
+    // Remap faces, dropping those whose corners collapsed together (block-wise
+    // prefix sum keeps the surviving faces in order)
+    const size_t numFaces = mesh.indices.size() / 3;
+    const size_t numBlocks = (numFaces + grain - 1) / grain;
+    std::vector<size_t> blockFaces(numBlocks + 1, 0);
+    auto mapped = [&](size_t f, int i) { return newIndex[root[mesh.indices[f * 3 + i]]]; };
+    auto collapsed = [&](size_t f) {
+        int a = mapped(f, 0), b = mapped(f, 1), c = mapped(f, 2);
+        return a == b || b == c || a == c;
+    };
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            size_t kept = 0;
+            for (size_t f = b * grain; f < std::min(numFaces, (b + 1) * grain); ++f) {
+                kept += !collapsed(f);
+            }
+            blockFaces[b + 1] = kept;
+        }
+    });
+    for (size_t b = 0; b < numBlocks; ++b) {
+        blockFaces[b + 1] += blockFaces[b];
+    }
+
+    std::vector<int> newIndices(blockFaces[numBlocks] * 3);
+    const bool trackOrigin = mesh.faceOrigin.size() == numFaces;
+    std::vector<int> newFaceOrigin(trackOrigin ? blockFaces[numBlocks] : 0);
+    parallelFor(numBlocks, 1, [&](size_t blockBegin, size_t blockEnd) {
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            size_t out = blockFaces[b];
+            for (size_t f = b * grain; f < std::min(numFaces, (b + 1) * grain); ++f) {
+                if (collapsed(f)) continue;
+                for (int i = 0; i < 3; ++i) {
+                    newIndices[out * 3 + i] = mapped(f, i);
+                }
+                if (trackOrigin) newFaceOrigin[out] = mesh.faceOrigin[f];
+                out++;
+            }
+        }
+    });
+    result.collapsedFaces = static_cast<int>(numFaces - blockFaces[numBlocks]);
+
+    std::cout << "Welded " << result.mergedVertices << " vertices (epsilon " << epsilon
+              << "), removed " << result.collapsedFaces << " collapsed faces\n";
+
+    mesh.vertices = std::move(newVertices);
+    mesh.indices = std::move(newIndices);
+    if (trackOrigin) mesh.faceOrigin = std::move(newFaceOrigin);
+    computeFaceNormals(mesh);
+    mesh.edgeToFaces = buildEdgeFaceAdjacency(mesh);
+    mesh.halfEdges = buildHalfEdges(mesh);
+    analyzeMesh(mesh.edgeToFaces);
+    findBoundaryFaces(mesh);
+    return result;
+}
@@ -0,0 +1,20 @@
+#ifndef WELD_H
+#define WELD_H
+
+#include "mesh.h"
+
+struct WeldResult {
+    int mergedVertices = 0;   // Vertices folded into another vertex
+    int collapsedFaces = 0;   // Faces dropped because two of their corners merged
+};
+
+// Merge vertices that lie within epsilon of each other, using a uniform hash
+// grid with cell size epsilon. Merging is transitive (a chain of close
+// vertices becomes one vertex) and every group keeps the position of its
+// lowest-index vertex, so the result is the same for any thread count.
+// epsilon is raised to at least 1e-12 times the largest absolute coordinate
+// (with a warning), which keeps the grid coordinates in range.
+// Rebuilds the adjacency and boundary classification afterwards.
+WeldResult weldVertices(Mesh& mesh, float epsilon);
+
+#endif